@@ -0,0 +1,174 @@
+#include "CCodeEmitter.hpp"
+
+#include <QByteArray>
+#include <QIODevice>
+
+static const int indentationWidth = 4;
+
+static inline bool isNewLine(QChar ch)
+{
+    return ch == QLatin1Char('\n');
+}
+
+static inline bool isNewLine(char ch)
+{
+    return ch == '\n';
+}
+
+CCodeEmitter::CCodeEmitter(QIODevice *device) :
+    m_stream(device),
+    m_indentLevel(0),
+    m_column(0),
+    m_atLineStart(true)
+{
+    m_stream.setCodec("UTF-8");
+}
+
+CCodeEmitter::CCodeEmitter(QByteArray *buffer) :
+    m_stream(buffer, QIODevice::WriteOnly),
+    m_indentLevel(0),
+    m_column(0),
+    m_atLineStart(true)
+{
+    m_stream.setCodec("UTF-8");
+}
+
+CCodeEmitter::CCodeEmitter(QString *string) :
+    m_stream(string, QIODevice::WriteOnly),
+    m_indentLevel(0),
+    m_column(0),
+    m_atLineStart(true)
+{
+}
+
+CCodeEmitter::~CCodeEmitter()
+{
+    m_stream.flush();
+}
+
+CCodeEmitter &CCodeEmitter::operator<<(const QString &text)
+{
+    writeText(text.constData(), text.size());
+    return *this;
+}
+
+CCodeEmitter &CCodeEmitter::operator<<(const QLatin1String &text)
+{
+    writeText(text.latin1(), text.size());
+    return *this;
+}
+
+CCodeEmitter &CCodeEmitter::operator<<(const char *text)
+{
+    writeText(text, qstrlen(text));
+    return *this;
+}
+
+CCodeEmitter &CCodeEmitter::operator<<(QChar ch)
+{
+    writeText(&ch, 1);
+    return *this;
+}
+
+CCodeEmitter &CCodeEmitter::operator<<(char ch)
+{
+    writeText(&ch, 1);
+    return *this;
+}
+
+CCodeEmitter &CCodeEmitter::operator<<(int number)
+{
+    writePendingIndentation();
+
+    const QString numberStr = QString::number(number);
+    m_stream << numberStr;
+    m_column += numberStr.size();
+
+    return *this;
+}
+
+void CCodeEmitter::indent()
+{
+    ++m_indentLevel;
+}
+
+void CCodeEmitter::unindent()
+{
+    if (m_indentLevel > 0) {
+        --m_indentLevel;
+    }
+}
+
+void CCodeEmitter::newLineAligned(int column)
+{
+    m_stream << QLatin1Char('\n');
+
+    for (int i = 0; i < column; ++i) {
+        m_stream << QLatin1Char(' ');
+    }
+
+    m_column = column;
+    m_atLineStart = false;
+}
+
+void CCodeEmitter::flush()
+{
+    m_stream.flush();
+}
+
+template<typename Char>
+void CCodeEmitter::writeText(const Char *text, int size)
+{
+    const Char *end = text + size;
+
+    while (text != end) {
+        if (m_atLineStart && !isNewLine(*text)) {
+            writePendingIndentation();
+        }
+
+        const Char *lineEnd = text;
+        while ((lineEnd != end) && !isNewLine(*lineEnd)) {
+            ++lineEnd;
+        }
+
+        if (lineEnd != end) {
+            ++lineEnd; // Include the new line character
+
+            writeChunk(text, lineEnd - text);
+            m_column = 0;
+            m_atLineStart = true;
+        } else {
+            writeChunk(text, lineEnd - text);
+            m_column += lineEnd - text;
+        }
+
+        text = lineEnd;
+    }
+}
+
+void CCodeEmitter::writeChunk(const QChar *text, int size)
+{
+    m_stream << QString::fromRawData(text, size);
+}
+
+void CCodeEmitter::writeChunk(const char *text, int size)
+{
+    m_stream << QLatin1String(text, size);
+}
+
+void CCodeEmitter::writePendingIndentation()
+{
+    if (!m_atLineStart) {
+        return;
+    }
+
+    m_atLineStart = false;
+
+    const int indentation = m_indentLevel * indentationWidth;
+
+    for (int i = 0; i < indentation; ++i) {
+        m_stream << QLatin1Char(' ');
+    }
+
+    m_column = indentation;
+}
@@ -0,0 +1,55 @@
+#ifndef CCODEEMITTER_HPP
+#define CCODEEMITTER_HPP
+
+#include <QString>
+#include <QTextStream>
+
+class QByteArray;
+class QIODevice;
+
+// Indentation-aware writer for the generated code.
+// The text is streamed to the target as it goes; no whole translation unit is kept in memory.
+// Indentation is inserted in front of every non-empty line, so the generators write lines without
+// leading spacing and use indent()/unindent() instead.
+class CCodeEmitter
+{
+public:
+    explicit CCodeEmitter(QIODevice *device);
+    explicit CCodeEmitter(QByteArray *buffer); // UTF-8
+    explicit CCodeEmitter(QString *string);
+    ~CCodeEmitter();
+
+    CCodeEmitter &operator<<(const QString &text);
+    CCodeEmitter &operator<<(const QLatin1String &text);
+    CCodeEmitter &operator<<(const char *text); // Latin-1
+    CCodeEmitter &operator<<(QChar ch);
+    CCodeEmitter &operator<<(char ch);
+    CCodeEmitter &operator<<(int number);
+
+    void indent();
+    void unindent();
+
+    // Starts a new line aligned to the given column, e.g. to line up continued argument lists.
+    // The indentation level is not applied to such a line.
+    void newLineAligned(int column);
+
+    // Current column of the output (including the indentation).
+    int column() const { return m_column; }
+
+    void flush();
+
+private:
+    template<typename Char>
+    void writeText(const Char *text, int size);
+    void writeChunk(const QChar *text, int size);
+    void writeChunk(const char *text, int size);
+    void writePendingIndentation();
+
+    QTextStream m_stream;
+    int m_indentLevel;
+    int m_column;
+    bool m_atLineStart;
+
+};
+
+#endif // CCODEEMITTER_HPP
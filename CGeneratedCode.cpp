@@ -0,0 +1,24 @@
+#include "CGeneratedCode.hpp"
+
+#include <QDataStream>
+
+QByteArray CGeneratedCode::serialize() const
+{
+    QByteArray result;
+    QDataStream stream(&result, QIODevice::WriteOnly);
+    stream << className << publicHeader << internalHeader << implementation << referencedTypes << typeDefinitions;
+    return result;
+}
+
+CGeneratedCode CGeneratedCode::deserialize(const QByteArray &data)
+{
+    CGeneratedCode result;
+    QDataStream stream(data);
+    stream >> result.className >> result.publicHeader >> result.internalHeader >> result.implementation >> result.referencedTypes >> result.typeDefinitions;
+
+    if (stream.status() != QDataStream::Ok) {
+        return CGeneratedCode();
+    }
+
+    return result;
+}
@@ -0,0 +1,26 @@
+#ifndef CGENERATEDCODE_HPP
+#define CGENERATEDCODE_HPP
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+#include "CTypeRegistry.hpp"
+
+// The three sections generated for one interface, encoded as UTF-8.
+struct CGeneratedCode
+{
+    QString className;
+    QByteArray publicHeader;
+    QByteArray internalHeader;
+    QByteArray implementation;
+    QStringList referencedTypes; // tp:type names used by the interface
+    CTypeRegistry typeDefinitions; // tp:type definitions of the spec, without a file name
+
+    bool isValid() const { return !className.isEmpty(); }
+
+    QByteArray serialize() const;
+    static CGeneratedCode deserialize(const QByteArray &data);
+};
+
+#endif // CGENERATEDCODE_HPP
@@ -0,0 +1,73 @@
+#include "CGenerationCache.hpp"
+
+#include "FileUtils.hpp"
+
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+
+static const QLatin1String s_entrySuffix = QLatin1String(".cache");
+
+CGenerationCache::CGenerationCache(const QString &directory, const QByteArray &generatorStamp) :
+    m_directory(directory),
+    m_generatorStamp(generatorStamp)
+{
+    if (!QDir().mkpath(m_directory)) {
+        qCritical() << "Could not create cache directory" << m_directory;
+        m_directory.clear();
+    }
+}
+
+bool CGenerationCache::isValid() const
+{
+    return !m_directory.isEmpty();
+}
+
+QByteArray CGenerationCache::key(const QByteArray &specContent) const
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(m_generatorStamp);
+    hash.addData("\n", 1);
+    hash.addData(specContent);
+
+    return hash.result().toHex();
+}
+
+bool CGenerationCache::lookup(const QByteArray &key, QByteArray *data) const
+{
+    QFile entryFile(entryFileName(key));
+    if (!entryFile.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    *data = entryFile.readAll();
+
+    return true;
+}
+
+void CGenerationCache::store(const QByteArray &key, const QByteArray &data) const
+{
+    // Entries are written via QSaveFile, so workers storing the same key at once are fine.
+    writeFileIfChanged(entryFileName(key), data);
+}
+
+QByteArray CGenerationCache::generatorStamp(const QString &generatorFileName)
+{
+    // Any rebuild of the generator invalidates the cache, not only a version bump.
+    QFile generatorFile(generatorFileName);
+    if (!generatorFile.open(QIODevice::ReadOnly)) {
+        qWarning() << "Could not read the generator binary" << generatorFileName << "for the cache stamp";
+        return QByteArray();
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(&generatorFile);
+
+    return hash.result().toHex();
+}
+
+QString CGenerationCache::entryFileName(const QByteArray &key) const
+{
+    return m_directory + QLatin1Char('/') + QString::fromLatin1(key) + s_entrySuffix;
+}
@@ -0,0 +1,30 @@
+#ifndef CGENERATIONCACHE_HPP
+#define CGENERATIONCACHE_HPP
+
+#include <QByteArray>
+#include <QString>
+
+class CGenerationCache
+{
+public:
+    CGenerationCache(const QString &directory, const QByteArray &generatorStamp);
+
+    bool isValid() const;
+    QString directory() const { return m_directory; }
+
+    QByteArray key(const QByteArray &specContent) const;
+
+    bool lookup(const QByteArray &key, QByteArray *data) const;
+    void store(const QByteArray &key, const QByteArray &data) const;
+
+    static QByteArray generatorStamp(const QString &generatorFileName);
+
+private:
+    QString entryFileName(const QByteArray &key) const;
+
+    QString m_directory;
+    QByteArray m_generatorStamp;
+
+};
+
+#endif // CGENERATIONCACHE_HPP
@@ -0,0 +1,447 @@
+#include "CGeneratorServer.hpp"
+
+#include "FileUtils.hpp"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTimer>
+#include <QtConcurrentMap>
+
+// JSON-RPC 2.0 error codes
+static const int s_parseError = -32700;
+static const int s_invalidRequest = -32600;
+static const int s_methodNotFound = -32601;
+static const int s_invalidParams = -32602;
+static const int s_generationError = 1;
+static const int s_writeError = 2;
+
+// Editors that save by unlinking and recreating a file leave it missing for a moment.
+static const int s_removalCheckDelay = 500; // ms
+
+// Used from the worker pool for the initial load, so it must only touch its own entry.
+struct CGeneratorServer::GenerateSpec
+{
+    explicit GenerateSpec(const CServiceGenerator *generator) :
+        m_generator(generator)
+    {
+    }
+
+    void operator()(SpecEntry &entry) const
+    {
+        entry.code = m_generator->generate(entry.content, &entry.errorString);
+    }
+
+    const CServiceGenerator *m_generator;
+};
+
+CGeneratorServer::CGeneratorServer(uint generationOptions, QObject *parent) :
+    QObject(parent),
+    m_generator(generationOptions),
+    m_server(new QLocalServer(this))
+{
+    connect(m_server, SIGNAL(newConnection()), SLOT(onNewConnection()));
+    connect(&m_watcher, SIGNAL(fileChanged(QString)), SLOT(onFileChanged(QString)));
+    connect(&m_watcher, SIGNAL(directoryChanged(QString)), SLOT(onDirectoryChanged(QString)));
+
+    m_removalTimer.setSingleShot(true);
+    m_removalTimer.setInterval(s_removalCheckDelay);
+    connect(&m_removalTimer, SIGNAL(timeout()), SLOT(onRemovalTimeout()));
+}
+
+CGeneratorServer::~CGeneratorServer()
+{
+}
+
+bool CGeneratorServer::listen(const QString &name)
+{
+    if (m_server->listen(name)) {
+        return true;
+    }
+
+    // A server that crashed leaves its socket file behind. Only remove it if nobody answers there.
+    if (m_server->serverError() == QAbstractSocket::AddressInUseError) {
+        QLocalSocket probe;
+        probe.connectToServer(name);
+
+        if (probe.waitForConnected(1000)) {
+            qCritical() << "Another server is already listening on" << name;
+            return false;
+        }
+
+        QLocalServer::removeServer(name);
+
+        if (m_server->listen(name)) {
+            return true;
+        }
+    }
+
+    qCritical() << "Could not listen on" << name << ":" << m_server->errorString();
+    return false;
+}
+
+void CGeneratorServer::addSpecFiles(const QStringList &fileNames)
+{
+    QList<SpecEntry> newEntries;
+
+    foreach (const QString &fileName, fileNames) {
+        const QString specPath = canonicalSpecPath(fileName);
+
+        if (m_specs.contains(specPath)) {
+            continue;
+        }
+
+        QFile xmlFile(specPath);
+        if (!xmlFile.open(QIODevice::ReadOnly)) {
+            qCritical() << "Could not open file" << specPath;
+            continue;
+        }
+
+        SpecEntry entry;
+        entry.fileName = specPath;
+        entry.content = xmlFile.readAll();
+        newEntries.append(entry);
+    }
+
+    QtConcurrent::blockingMap(newEntries, GenerateSpec(&m_generator));
+
+    foreach (const SpecEntry &entry, newEntries) {
+        if (!entry.code.isValid()) {
+            qWarning() << "Could not read spec" << entry.fileName << ":" << entry.errorString;
+        }
+
+        m_specs.insert(entry.fileName, entry);
+        m_watcher.addPath(entry.fileName);
+    }
+}
+
+void CGeneratorServer::addSpecDirectory(const QString &directory)
+{
+    const QDir specDir(directory);
+    if (!specDir.exists()) {
+        qCritical() << "Spec directory does not exist:" << directory;
+        return;
+    }
+
+    const QString directoryPath = specDir.absolutePath();
+
+    if (!m_directories.contains(directoryPath)) {
+        m_directories.insert(directoryPath);
+        m_watcher.addPath(directoryPath);
+    }
+
+    QStringList fileNames;
+    foreach (const QString &entry, specDir.entryList(QStringList() << QLatin1String("*.xml"), QDir::Files, QDir::Name)) {
+        fileNames.append(specDir.filePath(entry));
+    }
+
+    addSpecFiles(fileNames);
+}
+
+void CGeneratorServer::onNewConnection()
+{
+    while (QLocalSocket *client = m_server->nextPendingConnection()) {
+        connect(client, SIGNAL(readyRead()), SLOT(onClientReadyRead()));
+        connect(client, SIGNAL(disconnected()), SLOT(onClientDisconnected()));
+        m_clients.append(client);
+    }
+}
+
+void CGeneratorServer::onClientReadyRead()
+{
+    QLocalSocket *client = qobject_cast<QLocalSocket*>(sender());
+    if (!client) {
+        return;
+    }
+
+    while (client->canReadLine()) {
+        const QByteArray line = client->readLine().trimmed();
+
+        if (line.isEmpty()) {
+            continue;
+        }
+
+        QJsonParseError parseError;
+        const QJsonDocument document = QJsonDocument::fromJson(line, &parseError);
+
+        QJsonObject response;
+
+        if (parseError.error != QJsonParseError::NoError) {
+            response[QLatin1String("jsonrpc")] = QLatin1String("2.0");
+            response[QLatin1String("id")] = QJsonValue();
+            response[QLatin1String("error")] = errorObject(s_parseError, parseError.errorString());
+        } else if (!document.isObject()) {
+            response[QLatin1String("jsonrpc")] = QLatin1String("2.0");
+            response[QLatin1String("id")] = QJsonValue();
+            response[QLatin1String("error")] = errorObject(s_invalidRequest, QLatin1String("The request is not an object"));
+        } else {
+            response = processRequest(document.object());
+        }
+
+        // Notifications (requests without id) are not answered.
+        if (!response.isEmpty()) {
+            client->write(QJsonDocument(response).toJson(QJsonDocument::Compact) + '\n');
+            client->flush(); // The response to "shutdown" has to leave before the event loop quits
+        }
+    }
+}
+
+void CGeneratorServer::onClientDisconnected()
+{
+    QLocalSocket *client = qobject_cast<QLocalSocket*>(sender());
+    if (!client) {
+        return;
+    }
+
+    m_clients.removeOne(client);
+    client->deleteLater();
+}
+
+void CGeneratorServer::onFileChanged(const QString &fileName)
+{
+    // The file may be recreated in a moment; decide after the delay.
+    if (!QFile::exists(fileName)) {
+        m_pendingRemovals.insert(fileName);
+        m_removalTimer.start();
+        return;
+    }
+
+    // Editors that save via rename replace the watched file, and the watcher drops it.
+    if (!m_watcher.files().contains(fileName)) {
+        m_watcher.addPath(fileName);
+    }
+
+    if (updateSpec(fileName)) {
+        notifySpecChanged(fileName);
+    }
+}
+
+void CGeneratorServer::onRemovalTimeout()
+{
+    foreach (const QString &fileName, m_pendingRemovals) {
+        if (QFile::exists(fileName)) {
+            onFileChanged(fileName);
+            continue;
+        }
+
+        m_specs.remove(fileName);
+
+        QJsonObject params;
+        params[QLatin1String("file")] = fileName;
+        notifyClients(QLatin1String("specRemoved"), params);
+    }
+
+    m_pendingRemovals.clear();
+}
+
+void CGeneratorServer::notifySpecChanged(const QString &fileName)
+{
+    const SpecEntry &entry = m_specs[fileName];
+
+    QJsonObject params;
+    params[QLatin1String("file")] = fileName;
+    if (entry.code.isValid()) {
+        params[QLatin1String("className")] = entry.code.className;
+    } else {
+        params[QLatin1String("error")] = entry.errorString;
+    }
+    notifyClients(QLatin1String("specChanged"), params);
+}
+
+void CGeneratorServer::onDirectoryChanged(const QString &directory)
+{
+    // Removed files are reported by fileChanged(); only pick up the new ones.
+    addSpecDirectory(directory);
+}
+
+bool CGeneratorServer::updateSpec(const QString &fileName)
+{
+    QFile xmlFile(fileName);
+    if (!xmlFile.open(QIODevice::ReadOnly)) {
+        qCritical() << "Could not open file" << fileName;
+        return false;
+    }
+
+    const QByteArray content = xmlFile.readAll();
+
+    SpecEntry &entry = m_specs[fileName];
+
+    // Touched, but not changed
+    if (!entry.fileName.isEmpty() && (entry.content == content)) {
+        return false;
+    }
+
+    entry.fileName = fileName;
+    entry.content = content;
+    entry.errorString.clear();
+    entry.code = m_generator.generate(entry.content, &entry.errorString);
+
+    if (!entry.code.isValid()) {
+        qWarning() << "Could not read spec" << fileName << ":" << entry.errorString;
+    }
+
+    return true;
+}
+
+QString CGeneratorServer::canonicalSpecPath(const QString &fileName) const
+{
+    return QDir::cleanPath(QFileInfo(fileName).absoluteFilePath());
+}
+
+QJsonObject CGeneratorServer::processRequest(const QJsonObject &request)
+{
+    const QJsonValue id = request.value(QLatin1String("id"));
+    const QString method = request.value(QLatin1String("method")).toString();
+    const QJsonObject params = request.value(QLatin1String("params")).toObject();
+
+    QJsonObject result;
+    QJsonObject error;
+
+    if (method == QLatin1String("generate")) {
+        result = generateRequest(params, &error);
+    } else if (method == QLatin1String("list")) {
+        result = listRequest();
+    } else if (method == QLatin1String("shutdown")) {
+        QCoreApplication::quit();
+    } else {
+        error = errorObject(s_methodNotFound, QString(QLatin1String("Unknown method \"%1\"")).arg(method));
+    }
+
+    if (id.isUndefined()) {
+        return QJsonObject();
+    }
+
+    QJsonObject response;
+    response[QLatin1String("jsonrpc")] = QLatin1String("2.0");
+    response[QLatin1String("id")] = id;
+
+    if (error.isEmpty()) {
+        response[QLatin1String("result")] = result;
+    } else {
+        response[QLatin1String("error")] = error;
+    }
+
+    return response;
+}
+
+QJsonObject CGeneratorServer::generateRequest(const QJsonObject &params, QJsonObject *error)
+{
+    const QString fileName = params.value(QLatin1String("file")).toString();
+
+    if (fileName.isEmpty()) {
+        *error = errorObject(s_invalidParams, QLatin1String("The \"file\" parameter is missing"));
+        return QJsonObject();
+    }
+
+    const QString specPath = canonicalSpecPath(fileName);
+
+    // Unknown specs are loaded and watched from now on.
+    if (!m_specs.contains(specPath)) {
+        addSpecFiles(QStringList() << specPath);
+
+        if (!m_specs.contains(specPath)) {
+            *error = errorObject(s_generationError, QString(QLatin1String("Could not open file %1")).arg(specPath));
+            return QJsonObject();
+        }
+    }
+
+    const SpecEntry &entry = m_specs[specPath];
+
+    if (!entry.code.isValid()) {
+        *error = errorObject(s_generationError, entry.errorString);
+        return QJsonObject();
+    }
+
+    QJsonObject result;
+    result[QLatin1String("className")] = entry.code.className;
+
+    const QString outputDirectory = params.value(QLatin1String("outputDir")).toString();
+
+    if (outputDirectory.isEmpty()) {
+        result[QLatin1String("publicHeader")] = QString::fromUtf8(entry.code.publicHeader);
+        result[QLatin1String("internalHeader")] = QString::fromUtf8(entry.code.internalHeader);
+        result[QLatin1String("implementation")] = QString::fromUtf8(entry.code.implementation);
+        return result;
+    }
+
+    if (!QDir().mkpath(outputDirectory)) {
+        *error = errorObject(s_writeError, QString(QLatin1String("Could not create output directory %1")).arg(outputDirectory));
+        return QJsonObject();
+    }
+
+    const QString baseName = outputDirectory + QLatin1Char('/') + entry.code.className;
+    const QStringList fileNames = QStringList()
+            << baseName + QLatin1String(".h")
+            << baseName + QLatin1String("-internal.h")
+            << baseName + QLatin1String(".cpp");
+    const QList<QByteArray> sections = QList<QByteArray>()
+            << entry.code.publicHeader
+            << entry.code.internalHeader
+            << entry.code.implementation;
+
+    for (int i = 0; i < fileNames.count(); ++i) {
+        if (!writeFileIfChanged(fileNames.at(i), sections.at(i))) {
+            *error = errorObject(s_writeError, QString(QLatin1String("Could not write %1")).arg(fileNames.at(i)));
+            return QJsonObject();
+        }
+    }
+
+    result[QLatin1String("files")] = QJsonArray::fromStringList(fileNames);
+
+    return result;
+}
+
+QJsonObject CGeneratorServer::listRequest() const
+{
+    QJsonArray specs;
+
+    QStringList fileNames = m_specs.keys();
+    fileNames.sort();
+
+    foreach (const QString &fileName, fileNames) {
+        const SpecEntry &entry = m_specs[fileName];
+
+        QJsonObject spec;
+        spec[QLatin1String("file")] = fileName;
+        if (entry.code.isValid()) {
+            spec[QLatin1String("className")] = entry.code.className;
+        } else {
+            spec[QLatin1String("error")] = entry.errorString;
+        }
+        specs.append(spec);
+    }
+
+    QJsonObject result;
+    result[QLatin1String("specs")] = specs;
+
+    return result;
+}
+
+void CGeneratorServer::notifyClients(const QString &method, const QJsonObject &params)
+{
+    QJsonObject notification;
+    notification[QLatin1String("jsonrpc")] = QLatin1String("2.0");
+    notification[QLatin1String("method")] = method;
+    notification[QLatin1String("params")] = params;
+
+    const QByteArray data = QJsonDocument(notification).toJson(QJsonDocument::Compact) + '\n';
+
+    foreach (QLocalSocket *client, m_clients) {
+        client->write(data);
+    }
+}
+
+QJsonObject CGeneratorServer::errorObject(int code, const QString &message)
+{
+    QJsonObject error;
+    error[QLatin1String("code")] = code;
+    error[QLatin1String("message")] = message;
+
+    return error;
+}
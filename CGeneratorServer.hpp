@@ -0,0 +1,76 @@
+#ifndef CGENERATORSERVER_HPP
+#define CGENERATORSERVER_HPP
+
+#include <QByteArray>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QJsonObject>
+#include <QList>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
+
+#include "CGeneratedCode.hpp"
+#include "CServiceGenerator.hpp"
+
+class QLocalServer;
+class QLocalSocket;
+
+// Long-running generator for IDE and build system integration.
+// The generated code of every known spec is kept in memory and regenerated when the spec file changes,
+// so the requests are answered without reading or parsing anything.
+//
+// Clients connect to a local socket and send JSON-RPC 2.0 requests, one JSON object per line.
+class CGeneratorServer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit CGeneratorServer(uint generationOptions, QObject *parent = 0);
+    ~CGeneratorServer();
+
+    bool listen(const QString &name);
+
+    void addSpecFiles(const QStringList &fileNames);
+    void addSpecDirectory(const QString &directory); // New *.xml files of the directory are picked up too
+
+private Q_SLOTS:
+    void onNewConnection();
+    void onClientReadyRead();
+    void onClientDisconnected();
+    void onFileChanged(const QString &fileName);
+    void onDirectoryChanged(const QString &directory);
+    void onRemovalTimeout();
+
+private:
+    struct SpecEntry {
+        QString fileName;
+        QByteArray content;
+        CGeneratedCode code;
+        QString errorString;
+    };
+    struct GenerateSpec;
+
+    bool updateSpec(const QString &fileName); // Returns true if the generated code changed
+    QString canonicalSpecPath(const QString &fileName) const;
+
+    QJsonObject processRequest(const QJsonObject &request);
+    QJsonObject generateRequest(const QJsonObject &params, QJsonObject *error);
+    QJsonObject listRequest() const;
+    void notifySpecChanged(const QString &fileName);
+    void notifyClients(const QString &method, const QJsonObject &params);
+
+    static QJsonObject errorObject(int code, const QString &message);
+
+    CServiceGenerator m_generator;
+    QLocalServer *m_server;
+    QList<QLocalSocket*> m_clients;
+    QFileSystemWatcher m_watcher;
+    QHash<QString, SpecEntry> m_specs;
+    QSet<QString> m_directories;
+    QSet<QString> m_pendingRemovals;
+    QTimer m_removalTimer;
+
+};
+
+#endif // CGENERATORSERVER_HPP
@@ -1,14 +1,13 @@
 #include "CInterfaceGenerator.hpp"
 
+#include "CCodeEmitter.hpp"
+
 #include <QStringList>
 #include <QDebug>
 
 static const QLatin1String s_specFormat0 = QLatin1String("org.freedesktop.Telepathy.");
 static const QLatin1String s_specFormat1 = QLatin1String("im.telepathy.v1.");
 
-static const QString spacing = QLatin1String("    ");
-
-static bool compatibleWithQt4 = true;
 
 QString formatName(QString name)
 {
@@ -50,61 +49,45 @@ QString CNameFeature::nameFirstCapital() const
     return result;
 }
 
-void CTypeFeature::setTypeFromStr(const QString &type, const QString &tpType)
-{
-    if (type == QLatin1String("b")) {
-        m_type = QLatin1String("bool");
-        m_defaultValue = QLatin1String("false");
-    } else if (type == QLatin1String("y")) {
-        m_type = QLatin1String("uchar");
-    } else if (type == QLatin1String("n")) {
-        m_type = QLatin1String("short");
-    } else if (type == QLatin1String("q")) {
-        m_type = QLatin1String("ushort");
-    } else if (type == QLatin1String("i")) {
-        m_type = QLatin1String("int");
-    } else if (type == QLatin1String("u")) {
-        m_typeForAdaptee = QLatin1String("uint");
-
-        if (!tpType.endsWith(QLatin1String("Flags"))) {
-            m_type = m_typeForAdaptee;
-        }
+void CNameFeature::internName(CStringPool *pool)
+{
+    m_name = pool->intern(m_name);
+    m_nameAsIs = pool->intern(m_nameAsIs);
+}
 
-        if (tpType == QLatin1String("Contact_List_State")) {
-            m_defaultValue = QLatin1String("ContactListStateNone");
-        } else /*if (tpType == QLatin1String("Contact_Info_Flags"))*/ {
-            m_defaultValue = QLatin1String("0");
+void CTypeFeature::internStrings(CStringPool *pool)
+{
+    internName(pool);
+    m_signature = pool->intern(m_signature);
+    m_type = pool->intern(m_type);
+    m_typeForAdaptee = pool->intern(m_typeForAdaptee);
+    m_defaultValue = pool->intern(m_defaultValue);
+}
+
+void CTypeFeature::setTypeFromStr(const QString &type, const QString &tpType, CSignatureParser *parser)
+{
+    m_signature = type;
+    m_typeFlags = NoTypeFlags;
+    m_typeError = CSignatureParser::NoError;
+
+    const DBusTypeMapping *mapping = CSignatureParser::findMapping(type);
+
+    if (mapping) {
+        m_type = QLatin1String(mapping->type);
+        m_defaultValue = QLatin1String(mapping->defaultValue);
+        m_typeFlags = mapping->flags;
+
+        if (type == QLatin1String("u")) {
+            m_typeForAdaptee = m_type;
+
+            if (tpType.endsWith(QLatin1String("Flags"))) {
+                // Let it be supposed as Tp::<Name>Flags, which is passed as uint on the bus.
+                m_type.clear();
+                m_typeFlags = NoTypeFlags;
+            } else if (tpType == QLatin1String("Contact_List_State")) {
+                m_defaultValue = QLatin1String("ContactListStateNone");
+            }
         }
-    } else if (type == QLatin1String("x")) {
-        m_type = QLatin1String("qlonglong");
-    } else if (type == QLatin1String("t")) {
-        m_type = QLatin1String("qulonglong");
-    } else if (type == QLatin1String("d")) {
-        m_type = QLatin1String("double");
-    } else if (type == QLatin1String("s")) {
-        m_type = QLatin1String("QString");
-    } else if (type == QLatin1String("as")) {
-        m_type = QLatin1String("QStringList");
-    } else if (type == QLatin1String("au")) {
-        m_type = QLatin1String("Tp::UIntList");
-    } else if (type == QLatin1String("ay")) {
-        m_type = QLatin1String("QByteArray");
-    } else if (type == QLatin1String("o")) {
-        m_type = QLatin1String("QDBusObjectPath");
-    } else if (type == QLatin1String("ao")) {
-        m_type = QLatin1String("Tp::ObjectPathList");
-    } else if (type == QLatin1String("g")) {
-        m_type = QLatin1String("QDBusSignature");
-    } else if (type == QLatin1String("ag")) {
-        m_type = QLatin1String("Tp::SignatureList");
-    } else if (type == QLatin1String("v")) {
-        m_type = QLatin1String("QDBusVariant");
-    } else if (type == QLatin1String("av")) {
-        m_type = QLatin1String("QVariantList");
-    } else if (type == QLatin1String("aav")) {
-        m_type = QLatin1String("Tp::VariantListList");
-    } else if (type == QLatin1String("a{sv}")) {
-        m_type = QLatin1String("QVariantMap");
     } else {
         if (tpType == QLatin1String("Field_Spec[]") && type == QLatin1String("a(sasuu)")) {
             m_type = QLatin1String("Tp::FieldSpecs");
@@ -115,14 +98,20 @@ void CTypeFeature::setTypeFromStr(const QString &type, const QString &tpType)
     if (tpType == QLatin1String("Unix_Timestamp64")) {
         m_typeForAdaptee = m_type;
         m_type = QLatin1String("QDateTime");
-    }
-
-    if (m_defaultValue.isEmpty() && isPod()) {
-        m_defaultValue = QLatin1String("0");
+        m_defaultValue.clear();
+        m_typeFlags = NoTypeFlags;
     }
 
     if (m_type.isEmpty()) {
-        m_type = supposeType(type, tpType);
+        if (!tpType.isEmpty()) {
+            m_type = supposeType(type, tpType);
+        } else {
+            CSignatureParser localParser;
+            if (!parser) {
+                parser = &localParser;
+            }
+            m_type = parser->qtType(type, &m_typeError);
+        }
     }
 
     if (m_typeForAdaptee.isEmpty()) {
@@ -130,33 +119,17 @@ void CTypeFeature::setTypeFromStr(const QString &type, const QString &tpType)
     }
 }
 
-bool CTypeFeature::isPod() const
-{
-    static const QStringList podTypes = QStringList()
-            << QLatin1String("bool")
-            << QLatin1String("uchar")
-            << QLatin1String("short")
-            << QLatin1String("ushort")
-            << QLatin1String("int")
-            << QLatin1String("uint")
-            << QLatin1String("qlonglong")
-            << QLatin1String("qulonglong")
-            << QLatin1String("double");
-
-    return podTypes.contains(m_type);
-}
-
 QString CTypeFeature::formatTypeArgument(bool addName) const
 {
     if (isPod()) {
         if (addName) {
-            return QString(QLatin1String("%1 %2")).arg(m_type).arg(name());
+            return QString(QLatin1String("%1 %2")).arg(m_type, name());
         } else {
             return m_type;
         }
     } else {
         if (addName) {
-            return QString(QLatin1String("const %1 &%2")).arg(m_type).arg(name());
+            return QString(QLatin1String("const %1 &%2")).arg(m_type, name());
         } else {
             return QString(QLatin1String("const %1 &")).arg(m_type);
         }
@@ -165,14 +138,19 @@ QString CTypeFeature::formatTypeArgument(bool addName) const
     return QString();
 }
 
+QString CTypeFeature::formatRvalueTypeArgument(bool addName) const
+{
+    if (addName) {
+        return QString(QLatin1String("%1 &&%2")).arg(m_type, name());
+    } else {
+        return QString(QLatin1String("%1 &&")).arg(m_type);
+    }
+}
+
 QString CTypeFeature::supposeType(const QString &type, QString tpType) const
 {
     Q_UNUSED(type);
 
-    if (tpType.isEmpty()) {
-        qDebug() << "Can't suppose type: There is no tp-type tag. Type:" << type;
-    }
-
     QString suffix;
     if (tpType.endsWith(QLatin1String("[]"))) {
         tpType.chop(2);
@@ -197,7 +175,7 @@ QString CMethodArgument::formatArgument(bool addName) const
 {
     if (m_direction == Output) {
         if (addName) {
-            return QString(QLatin1String("%1 &%2")).arg(type()).arg(name());
+            return QString(QLatin1String("%1 &%2")).arg(type(), name());
         } else {
             return QString(QLatin1String("%1 &")).arg(type());
         }
@@ -269,11 +247,35 @@ void CInterfaceMethod::prepare()
     m_callbackRetType = retType;
 }
 
+int CInterfaceMethod::inputArgsCount() const
+{
+    return arguments.count() - m_outputArgsIndices.count();
+}
+
+QString CInterfaceMethod::contextPtrType() const
+{
+    // Same as the <Method>ContextPtr typedef of the service adaptor, so the adaptor types are used.
+    QStringList outputTypes;
+    foreach (uint index, m_outputArgsIndices) {
+        outputTypes.append(arguments.at(index).typeForAdaptee());
+    }
+
+    QString result = QLatin1String("Tp::MethodInvocationContextPtr<") + outputTypes.join(QLatin1String(", "));
+    if (result.endsWith(QLatin1Char('>'))) {
+        result.append(QLatin1Char(' '));
+    }
+    result.append(QLatin1Char('>'));
+
+    return result;
+}
+
 CInterfaceGenerator::CInterfaceGenerator() :
     m_type(InterfaceTypeInvalid),
     m_mutablePropertiesCount(0),
     m_immutablePropertiesCount(0),
-    m_emitPropertiesChangedSignal(false)
+    m_coalescedPropertiesCount(0),
+    m_emitPropertiesChangedSignal(false),
+    m_options(NoGenerationOptions)
 {
 }
 
@@ -305,7 +307,7 @@ QString CInterfaceGenerator::className() const
         break;
     }
 
-    return QString(QLatin1String("Base%1%2%3")).arg(classBaseType()).arg(nodeName()).arg(classSuffix);
+    return QString(QLatin1String("Base%1%2%3")).arg(classBaseType(), nodeName(), classSuffix);
 }
 
 QString CInterfaceGenerator::parentClassPrefix() const
@@ -434,6 +436,7 @@ void CInterfaceGenerator::setFullName(const QString &name)
 
     nameParts = nameParts.mid(3);
     m_fullName = nameParts.join(QLatin1Char('.'));
+    m_dbusName = name;
 }
 
 QString CInterfaceGenerator::shortName() const
@@ -485,10 +488,64 @@ void CInterfaceGenerator::setEmitPropertiesChangedSignal(bool enable)
     m_emitPropertiesChangedSignal = enable;
 }
 
+void CInterfaceGenerator::setOptions(uint options)
+{
+    m_options = options;
+}
+
+bool CInterfaceGenerator::hasOption(GenerationOption option) const
+{
+    return m_options & option;
+}
+
+CInterfaceProperty *CInterfaceGenerator::createProperty()
+{
+    return m_arena.create<CInterfaceProperty>();
+}
+
+CInterfaceMethod *CInterfaceGenerator::createMethod(const QString &name)
+{
+    return m_arena.create<CInterfaceMethod>(name);
+}
+
+CInterfaceSignal *CInterfaceGenerator::createSignal(const QString &name)
+{
+    return m_arena.create<CInterfaceSignal>(name);
+}
+
+void CInterfaceGenerator::clearModel()
+{
+    m_signalsByName.clear();
+    m_properties.clear();
+    m_methods.clear();
+    m_signals.clear();
+    m_arena.clear();
+    m_stringPool.clear();
+    m_referencedTypes.clear();
+}
+
+void CInterfaceGenerator::addReferencedType(const QString &typeName)
+{
+    if (!m_referencedTypes.contains(typeName)) {
+        m_referencedTypes.append(typeName);
+    }
+}
+
 void CInterfaceGenerator::prepare()
 {
     m_mutablePropertiesCount = 0;
     m_immutablePropertiesCount = 0;
+    m_coalescedPropertiesCount = 0;
+
+    m_signalsByName.clear();
+    m_signalsByName.reserve(m_signals.count());
+
+    for (int i = 0; i < m_signals.count(); ++i) {
+        // The first signal with the name wins, as in the spec order.
+        if (!m_signalsByName.contains(m_signals.at(i)->name())) {
+            m_signalsByName.insert(m_signals.at(i)->name(), m_signals.at(i));
+        }
+    }
 
     for (int i = 0; i < m_properties.count(); ++i) {
         if (m_properties.at(i)->isImmutable()) {
@@ -497,12 +554,14 @@ void CInterfaceGenerator::prepare()
             ++m_mutablePropertiesCount;
         }
 
-        for (int j = 0; j < m_signals.count(); ++j) {
-            if (m_signals.at(j)->name() == m_properties.at(i)->name() + QLatin1String("Changed")) {
-                m_properties[i]->setNotifier(m_signals.at(j));
-                m_signals[j]->setNotifierFlag(true);
-                break;
-            }
+        CInterfaceSignal *notifier = signalByName(m_properties.at(i)->name() + QLatin1String("Changed"));
+        if (notifier) {
+            m_properties[i]->setNotifier(notifier);
+            notifier->setNotifierFlag(true);
+        }
+
+        if (isCoalescedProperty(m_properties.at(i))) {
+            ++m_coalescedPropertiesCount;
         }
     }
 
@@ -517,119 +576,186 @@ void CInterfaceGenerator::prepare()
     }
 }
 
-QString CInterfaceGenerator::generateImmutablePropertiesListHelper(const int creatorSpacing, bool names, bool signatures) const
+CInterfaceSignal *CInterfaceGenerator::signalByName(const QString &name) const
 {
-    QString result;
+    return m_signalsByName.value(name);
+}
 
-    QString creatorSpacingStr;
+bool CInterfaceGenerator::hasRvalueSetter(const CInterfaceProperty *prop) const
+{
+    // Notifier setters pass the arguments on to the signal, so there is nothing to move into.
+    return hasOption(MoveAwareSetters) && !prop->isImmutable() && !prop->notifier() && !prop->isPod();
+}
 
-    if (creatorSpacing > 0) {
-        creatorSpacingStr = QString(creatorSpacing, QLatin1Char(' '));
+bool CInterfaceGenerator::hasAtomicStorage(const CInterfaceProperty *prop) const
+{
+    return hasOption(ThreadSafeProperties) && !prop->isImmutable() && prop->isPod();
+}
+
+bool CInterfaceGenerator::hasSnapshotStorage(const CInterfaceProperty *prop) const
+{
+    return hasOption(ThreadSafeProperties) && !prop->isImmutable() && !prop->isPod();
+}
+
+QString CInterfaceGenerator::storedValue(const CInterfaceProperty *prop) const
+{
+    if (hasAtomicStorage(prop)) {
+        return QString(QLatin1String("mPriv->%1.load()")).arg(prop->name());
+    } else if (hasSnapshotStorage(prop)) {
+        return QString(QLatin1String("*std::atomic_load(&mPriv->%1)")).arg(prop->name());
     }
 
+    return QLatin1String("mPriv->") + prop->name();
+}
+
+QString CInterfaceGenerator::storeValue(const CInterfaceProperty *prop, const QString &value) const
+{
+    if (hasAtomicStorage(prop)) {
+        return QString(QLatin1String("mPriv->%1.store(%2)")).arg(prop->name(), value);
+    } else if (hasSnapshotStorage(prop)) {
+        return QString(QLatin1String("std::atomic_store(&mPriv->%1, std::make_shared<%2>(%3))"))
+                .arg(prop->name(), templateArgument(QLatin1String("const ") + prop->type()), value);
+    }
+
+    return QString(QLatin1String("mPriv->%1 = %2")).arg(prop->name(), value);
+}
+
+QString CInterfaceGenerator::templateArgument(const QString &type)
+{
+    // Keep the generated code valid for C++98 too, where ">>" closes nothing.
+    if (type.endsWith(QLatin1Char('>'))) {
+        return type + QLatin1Char(' ');
+    }
+
+    return type;
+}
+
+bool CInterfaceGenerator::isCoalescedProperty(const CInterfaceProperty *prop) const
+{
+    // Properties with a notifier signal are announced by the signal, not by PropertiesChanged.
+    return m_emitPropertiesChangedSignal && hasOption(CoalescePropertyChanges)
+            && !prop->isImmutable() && !prop->notifier();
+}
+
+void CInterfaceGenerator::generateImmutablePropertiesListHelper(CCodeEmitter &out, const int creatorSpacing, bool names, bool signatures) const
+{
+    bool first = true;
+
     for (int i = 0; i < m_properties.count(); ++i) {
         if (!m_properties.at(i)->isImmutable()) {
             continue;
         }
 
-        if (!result.isEmpty()) {
-            result += QLatin1Char(',');
+        if (!first) {
+            out << ',';
             if (creatorSpacing > 0) {
-                result += QLatin1Char('\n') + creatorSpacingStr;
+                out.newLineAligned(creatorSpacing);
             } else {
-                result += QLatin1Char(' ');
+                out << ' ';
             }
         }
+        first = false;
 
         if (signatures) {
-            result += m_properties.at(i)->formatTypeArgument(names);
+            out << m_properties.at(i)->formatTypeArgument(names);
         } else {
             // Assume it as names only
-            result += m_properties.at(i)->name();
+            out << m_properties.at(i)->name();
         }
     }
-
-    return result;
 }
 
-QString CInterfaceGenerator::generatePrivateConstructorPropertiesList(const int creatorSpacing) const
+void CInterfaceGenerator::generatePrivateConstructorPropertiesList(CCodeEmitter &out, const int creatorSpacing) const
 {
-    QString result;
-    QString creatorSpacingStr(creatorSpacing, QLatin1Char(' '));
-
     for (int i = 0; i < m_properties.count(); ++i) {
         CInterfaceProperty *prop = m_properties.at(i);
-        QString propValue;
 
         if (prop->isImmutable()) {
-            propValue = prop->name();
+            out << prop->name() << '(' << prop->name() << "),";
         } else {
             if (prop->isPod()) {
-                propValue = prop->defaultValue();
+                out << prop->name() << '(' << prop->defaultValue() << "),";
+            } else if (hasSnapshotStorage(prop)) {
+                out << prop->name() << "(std::make_shared<" << templateArgument(QLatin1String("const ") + prop->type()) << ">()),";
             } else {
                 continue;
             }
         }
 
-        result += QString(QLatin1String("%1(%2),\n")).arg(prop->name()).arg(propValue);
-        result += creatorSpacingStr;
+        out.newLineAligned(creatorSpacing);
     }
-
-    return result;
 }
 
-QString CInterfaceGenerator::generateHeaderInterface() const
+void CInterfaceGenerator::generateHeaderInterface(CCodeEmitter &out) const
 {
-    QString result;
-
-    result += QLatin1String("class TP_QT_EXPORT ") + className();
+    out << "class TP_QT_EXPORT " << className();
 
     if (m_subType == InterfaceSubTypeBaseClass) {
-        result += QLatin1String(" : public DBusService\n{\n");
+        out << " : public DBusService\n{\n";
     } else {
-        result += QString(QLatin1String(" : public Abstract%1Interface\n{\n")).arg(parentClassPrefix());
+        out << " : public Abstract" << parentClassPrefix() << "Interface\n{\n";
     }
 
-    result += QString(QLatin1String("%1Q_OBJECT\n")).arg(spacing);
-    result += QString(QLatin1String("%1Q_DISABLE_COPY(%2)\n\n")).arg(spacing).arg(className());
+    out.indent();
+    out << "Q_OBJECT\n";
+    out << "Q_DISABLE_COPY(" << className() << ")\n\n";
+    out.unindent();
 
-    result += QLatin1String("public:\n");
+    out << "public:\n";
+    out.indent();
 
-    QString creatorLine;
     // Create
-    creatorLine = spacing + QString(QLatin1String("static %1 create(")).arg(classPtr());
-    result += creatorLine;
-    result += generateImmutablePropertiesListHelper(creatorLine.size(), /* names */ true, /* signature */ true);
-    result += QLatin1String(")\n");
-    result += spacing + QLatin1String("{\n");
-    creatorLine = spacing + spacing + QString(QLatin1String("return %1(new %2(")).arg(classPtr()).arg(className());
-    result += creatorLine;
-    result += generateImmutablePropertiesListHelper(creatorLine.size(), /* names */ true, /* signature */ false);
-    result += QLatin1String("));\n");
-    result += spacing + QLatin1String("}\n");
+    out << "static " << classPtr() << " create(";
+    generateImmutablePropertiesListHelper(out, out.column(), /* names */ true, /* signature */ true);
+    out << ")\n";
+    out << "{\n";
+    out.indent();
+    out << "return " << classPtr() << "(new " << className() << '(';
+    generateImmutablePropertiesListHelper(out, out.column(), /* names */ true, /* signature */ false);
+    out << "));\n";
+    out.unindent();
+    out << "}\n";
 
     // Subclass template
-    result += spacing + QString(QLatin1String("template<typename %1>\n")).arg(interfaceSubclass());
-
-    creatorLine = spacing + QString(QLatin1String("static SharedPtr<%1> create(")).arg(interfaceSubclass());
-    result += creatorLine;
-    result += generateImmutablePropertiesListHelper(creatorLine.size(), /* names */ true, /* signature */ true);
-    result += QLatin1String(")\n");
-    result += spacing + QLatin1String("{\n");
-    result += spacing + spacing + QString(QLatin1String("return SharedPtr<%1>(\n")).arg(interfaceSubclass());
-//
-    creatorLine = spacing + spacing + spacing + spacing;
-    creatorLine += QString(QLatin1String("new %1(")).arg(interfaceSubclass());
-    result += creatorLine;
-    result += generateImmutablePropertiesListHelper(creatorLine.size(), /* names */ true, /* signature */ false);
-    result += QLatin1String("));\n");
-    result += spacing + QLatin1String("}\n");
-
-    result += QLatin1Char('\n');
-    result += spacing + QString(QLatin1String("virtual ~%1();\n")).arg(className());
-    result += QLatin1Char('\n');
-    result += spacing + QLatin1String("QVariantMap immutableProperties() const;\n");
-    result += QLatin1Char('\n');
+    out << "template<typename " << interfaceSubclass() << ">\n";
+    out << "static SharedPtr<" << interfaceSubclass() << "> create(";
+    generateImmutablePropertiesListHelper(out, out.column(), /* names */ true, /* signature */ true);
+    out << ")\n";
+    out << "{\n";
+    out.indent();
+    out << "return SharedPtr<" << interfaceSubclass() << ">(\n";
+    out.indent();
+    out.indent();
+    out << "new " << interfaceSubclass() << '(';
+    generateImmutablePropertiesListHelper(out, out.column(), /* names */ true, /* signature */ false);
+    out << "));\n";
+    out.unindent();
+    out.unindent();
+    out.unindent();
+    out << "}\n";
+
+    out << '\n';
+    out << "virtual ~" << className() << "();\n";
+    out << '\n';
+    out << "QVariantMap immutableProperties() const;\n";
+    out << '\n';
+
+    if (hasOption(MethodStatistics)) {
+        out << "struct MethodStatistics\n";
+        out << "{\n";
+        out.indent();
+        out << "enum { LatencyBucketCount = 7 };\n";
+        out << '\n';
+        out << "QString name;\n";
+        out << "quint64 callCount;\n";
+        out << "quint64 errorCount;\n";
+        out << "// Calls faster than 10 us, 100 us, 1 ms, 10 ms, 100 ms, 1 s and the slower ones\n";
+        out << "QVector<quint64> latencyHistogram;\n";
+        out.unindent();
+        out << "};\n";
+        out << "static QList<MethodStatistics> methodStatistics();\n";
+        out << '\n';
+    }
 
     // Immutable properties
     if (m_immutablePropertiesCount) {
@@ -638,11 +764,9 @@ QString CInterfaceGenerator::generateHeaderInterface() const
                 continue;
             }
 
-            result += spacing + QString(QLatin1String("%1 %2() const;\n")).arg(prop->type()).arg(prop->name());
-        }
-        if (!result.endsWith(QLatin1String("\n\n"))) {
-            result += QLatin1Char('\n');
+            out << prop->type() << ' ' << prop->name() << "() const;\n";
         }
+        out << '\n';
     }
 
     // Mutable properties
@@ -652,20 +776,30 @@ QString CInterfaceGenerator::generateHeaderInterface() const
                 continue;
             }
 
-            result += spacing + QString(QLatin1String("%1 %2() const;\n")).arg(prop->type()).arg(prop->name());
+            out << prop->type() << ' ' << prop->name() << "() const;\n";
+            out << "void set" << prop->nameFirstCapital() << '(';
             if (prop->notifier()) {
-                result += spacing + QString(QLatin1String("void set%1(%2);\n")).arg(prop->nameFirstCapital()).arg(formatArguments(prop->notifier(), /* addName*/ true));
+                writeArguments(out, prop->notifier(), /* addName*/ true);
             } else {
-                result += spacing + QString(QLatin1String("void set%1(%2);\n")).arg(prop->nameFirstCapital()).arg(prop->formatTypeArgument(/* addName*/ true));
+                out << prop->formatTypeArgument(/* addName*/ true);
             }
-            result += QLatin1Char('\n');
+            out << ");\n";
+            if (hasRvalueSetter(prop)) {
+                out << "void set" << prop->nameFirstCapital() << '(' << prop->formatRvalueTypeArgument(/* addName*/ true) << ");\n";
+            }
+            out << '\n';
         }
     }
 
+    if (m_coalescedPropertiesCount) {
+        out << "Q_INVOKABLE void commitPropertyChanges();\n";
+        out << '\n';
+    }
+
     // Methods
     foreach (const CInterfaceMethod *method, m_methods) {
-        result += generateMethodCallbackAndDeclaration(method);
-        result += QLatin1Char('\n');
+        generateMethodCallbackAndDeclaration(out, method);
+        out << '\n';
     }
 
     // Signals (not notifiers)
@@ -674,238 +808,386 @@ QString CInterfaceGenerator::generateHeaderInterface() const
             continue;
         }
 
-        result += spacing + QString(QLatin1String("void %1(%2);\n")).arg(signal->name()).arg(formatArguments(signal, /* addName*/ true));
+        out << "void " << signal->name() << '(';
+        writeArguments(out, signal, /* addName*/ true);
+        out << ");\n";
     }
 
     if (!m_signals.isEmpty()) {
-        result += QLatin1Char('\n');
+        out << '\n';
     }
-
-    result += QLatin1String("protected:\n");
-    creatorLine = spacing + className() + QLatin1Char('(');
-    result += creatorLine;
-    result += generateImmutablePropertiesListHelper(creatorLine.size(), /* names */ true, /* signature */ true);
-    result += QLatin1String(");\n");
-
-    result += QLatin1Char('\n');
-    result += QLatin1String("private:\n");
-
-    result += spacing + QLatin1String("void createAdaptor();\n\n");
-    result += spacing + QLatin1String("class Adaptee;\n");
-    result += spacing + QLatin1String("friend class Adaptee;\n");
-    result += spacing + QLatin1String("struct Private;\n");
-    result += spacing + QLatin1String("friend struct Private;\n");
-    result += spacing + QLatin1String("Private *mPriv;\n");
-    result += QLatin1String("};\n\n");
-
-    return result;
+    out.unindent();
+
+    out << "protected:\n";
+    out.indent();
+    out << className() << '(';
+    generateImmutablePropertiesListHelper(out, out.column(), /* names */ true, /* signature */ true);
+    out << ");\n";
+    out.unindent();
+
+    out << '\n';
+    out << "private:\n";
+    out.indent();
+
+    out << "void createAdaptor();\n";
+    if (m_coalescedPropertiesCount) {
+        out << "void schedulePropertyChangesCommit();\n";
+    }
+    out << '\n';
+    out << "class Adaptee;\n";
+    out << "friend class Adaptee;\n";
+    out << "struct Private;\n";
+    out << "friend struct Private;\n";
+    out << "Private *mPriv;\n";
+    out.unindent();
+    out << "};\n\n";
 }
 
-QString CInterfaceGenerator::generateHeaderAdaptee() const
+void CInterfaceGenerator::generateHeaderAdaptee(CCodeEmitter &out) const
 {
-    QString result;
-
-    result += QString(QLatin1String("class TP_QT_NO_EXPORT %1::Adaptee : public QObject\n")).arg(className());
+    out << "class TP_QT_NO_EXPORT " << className() << "::Adaptee : public QObject\n";
 
-    result += QLatin1String("{\n");
-    result += spacing + QLatin1String("Q_OBJECT\n");
+    out << "{\n";
+    out.indent();
+    out << "Q_OBJECT\n";
 
     foreach (const CInterfaceProperty *prop, m_properties) {
-        result += spacing + QString(QLatin1String("Q_PROPERTY(%1 %2 READ %2)\n")).arg(prop->typeForAdaptee()).arg(prop->name());
+        out << "Q_PROPERTY(" << prop->typeForAdaptee() << ' ' << prop->name() << " READ " << prop->name() << ")\n";
     }
+    out.unindent();
 
-    result += QLatin1Char('\n');
-    result += QLatin1String("public:\n");
-    result += spacing + QString(QLatin1String("Adaptee(%1 *interface);\n")).arg(className());
-    result += spacing + QLatin1String("~Adaptee();\n");
+    out << '\n';
+    out << "public:\n";
+    out.indent();
+    out << "Adaptee(" << className() << " *interface);\n";
+    out << "~Adaptee();\n";
 
-    result += QLatin1Char('\n');
+    out << '\n';
 
     if (!m_properties.isEmpty()) {
         foreach (const CInterfaceProperty *prop, m_properties) {
-            result += spacing + QString(QLatin1String("%1 %2() const;\n")).arg(prop->typeForAdaptee()).arg(prop->name());
+            out << prop->typeForAdaptee() << ' ' << prop->name() << "() const;\n";
         }
 
-        result += QLatin1Char('\n');
+        out << '\n';
     }
+    out.unindent();
 
     if (!m_methods.isEmpty()) {
-        result += QLatin1String("private Q_SLOTS:\n");
-
+        out << "private Q_SLOTS:\n";
+        out.indent();
 
         foreach (const CInterfaceMethod *method, m_methods) {
-            result += spacing + QString(QLatin1String("void %1(%2\n")).arg(method->name())
-                    .arg(method->isSimple() ? QString() : formatArguments(method, /* name */ true, /* hideOutput */ true) + QLatin1String(","));
-            result += spacing + spacing + spacing + QString(QLatin1String("const %1::%2ContextPtr &context);\n")).arg(getServiceAdaptor()).arg(method->nameAsIs());
+            out << "void " << method->name() << '(';
+            if (!method->isSimple()) {
+                writeArguments(out, method, /* name */ true, /* hideOutput */ true);
+                out << ',';
+            }
+            out << '\n';
+            out.indent();
+            out.indent();
+            out << "const " << getServiceAdaptor() << "::" << method->nameAsIs() << "ContextPtr &context);\n";
+            out.unindent();
+            out.unindent();
         }
+        out.unindent();
 
-        result += QLatin1Char('\n');
+        out << '\n';
     }
 
     if (!m_signals.isEmpty()) {
-        result += QLatin1String("Q_SIGNALS:\n");
+        out << "Q_SIGNALS:\n";
+        out.indent();
         foreach (const CInterfaceSignal *sig, m_signals) {
-            result += spacing + QString(QLatin1String("void %1(%2);\n")).arg(sig->name()).arg(formatArguments(sig, /* name */ true));
+            out << "void " << sig->name() << '(';
+            writeArguments(out, sig, /* name */ true);
+            out << ");\n";
         }
+        out.unindent();
 
-        result += QLatin1Char('\n');
+        out << '\n';
     }
 
-    result += QLatin1String("private:\n");
-    result += spacing + QString(QLatin1String("%1 *%2;\n")).arg(className()).arg(m_adapteeParentMember);
-
-    result += QLatin1String("};\n");
+    out << "private:\n";
+    out.indent();
+    if (hasOption(MethodStatistics) && !m_methods.isEmpty()) {
+        out << "static void recordMethodCall(int methodIndex, qint64 elapsedNsecs, bool failed);\n";
+        out << '\n';
+    }
+    out << className() << " *" << m_adapteeParentMember << ";\n";
+    out.unindent();
 
-    return result;
+    out << "};\n";
 }
 
-QString CInterfaceGenerator::generateImplementations() const
+void CInterfaceGenerator::generateImplementations(CCodeEmitter &out) const
 {
-    QString result;
+    out << "// " << shortName() << '\n';
+    out << "// The " << className() << " code is fully or partially generated by the TelepathyQt-Generator.\n";
 
-    result += QLatin1String("// ") + shortName() + QLatin1Char('\n');
-    result += QLatin1String("// The ") + className() + QLatin1String(" code is fully or partially generated by the TelepathyQt-Generator.\n");
+    if (hasOption(StaticNameTable)) {
+        generateNamesTable(out);
+    }
 
-    result += generateImplementationPrivate();
-    result += generateImplementationAdaptee();
-    result += generateImplementationInterface();
+    if (hasOption(TraceHook)) {
+        // Can be defined by the project to collect the data somewhere else.
+        out << '\n';
+        // The default hook is compiled out in release builds, together with the timer.
+        out << "#ifndef TP_QT_ADAPTEE_TRACE_HOOK\n";
+        out << "#if defined(QT_NO_DEBUG) && !defined(TP_QT_ENABLE_ADAPTEE_TRACE)\n";
+        out << "#define TP_QT_ADAPTEE_TRACE_HOOK(method, argumentsSize, elapsedNsecs) do { } while (0)\n";
+        out << "#define TP_QT_ADAPTEE_TRACE_TIMER(timer) do { } while (0)\n";
+        out << "#else\n";
+        out << "#define TP_QT_ADAPTEE_TRACE_HOOK(method, argumentsSize, elapsedNsecs) "
+               "debug() << method << \"arguments size:\" << argumentsSize << \"time (ns):\" << elapsedNsecs\n";
+        out << "#endif\n";
+        out << "#endif\n";
+        out << "#ifndef TP_QT_ADAPTEE_TRACE_TIMER\n";
+        out << "#define TP_QT_ADAPTEE_TRACE_TIMER(timer) QElapsedTimer timer; timer.start()\n";
+        out << "#endif\n";
+        out << '\n';
+    } else if (hasOption(TraceMacro)) {
+        out << '\n';
+        out << "#ifndef TP_QT_ADAPTEE_TRACE\n";
+        out << "#if defined(QT_NO_DEBUG) && !defined(TP_QT_ENABLE_ADAPTEE_TRACE)\n";
+        out << "#define TP_QT_ADAPTEE_TRACE(method) do { } while (0)\n";
+        out << "#else\n";
+        out << "#define TP_QT_ADAPTEE_TRACE(method) debug() << method\n";
+        out << "#endif\n";
+        out << "#endif\n";
+        out << '\n';
+    }
 
-    return result;
+    generateImplementationPrivate(out);
+    generateImplementationAdaptee(out);
+    generateImplementationInterface(out);
 }
 
 QString CInterfaceGenerator::getServiceAdaptor() const
 {
-    return QString(QLatin1String("Tp::Service::%1%2%3Adaptor")).arg(parentClassPrefix()).arg(subTypeStr()).arg(nodeName());
+    return QString(QLatin1String("Tp::Service::%1%2%3Adaptor")).arg(parentClassPrefix(), subTypeStr(), nodeName());
 }
 
-QString CInterfaceGenerator::generateImplementationAdaptee() const
+void CInterfaceGenerator::generateImplementationAdaptee(CCodeEmitter &out) const
 {
-    QString result;
-
     const QString adapteeClassName = className() + QLatin1String("::Adaptee");
 
-    result += QString(QLatin1String("%1::Adaptee(%2 *interface)\n")).arg(adapteeClassName).arg(className());
-    result += spacing + QLatin1String(": QObject(interface),\n");
-    result += spacing + QString(QLatin1String("  %1(interface)\n")).arg(m_adapteeParentMember);
-    result += QLatin1String("{\n}\n\n");
+    out << adapteeClassName << "::Adaptee(" << className() << " *interface)\n";
+    out.indent();
+    out << ": QObject(interface),\n";
+    out << "  " << m_adapteeParentMember << "(interface)\n";
+    out.unindent();
+    out << "{\n}\n\n";
 
-    result += QString(QLatin1String("%1::~Adaptee()\n")).arg(adapteeClassName);
-    result += QLatin1String("{\n}\n\n");
+    out << adapteeClassName << "::~Adaptee()\n";
+    out << "{\n}\n\n";
+
+    if (hasOption(MethodStatistics) && !m_methods.isEmpty()) {
+        generateMethodStatisticsRecorder(out);
+    }
 
     // Properties
     foreach (const CInterfaceProperty *prop, m_properties) {
-        result += QString(QLatin1String("%1 %2::%3() const\n")).arg(prop->typeForAdaptee()).arg(adapteeClassName).arg(prop->name());
-        result += QLatin1String("{\n");
-        result += spacing + QString(QLatin1String("return %1->%2;\n")).arg(m_adapteeParentMember).arg(prop->dbusGetter());
-        result += QLatin1String("}\n");
-        result += QLatin1Char('\n');
+        out << prop->typeForAdaptee() << ' ' << adapteeClassName << "::" << prop->name() << "() const\n";
+        out << "{\n";
+        out.indent();
+        out << "return " << m_adapteeParentMember << "->" << prop->dbusGetter() << ";\n";
+        out.unindent();
+        out << "}\n";
+        out << '\n';
     }
 
     // Methods
+    int methodIndex = 0;
     foreach (const CInterfaceMethod *method, m_methods) {
-        result += QString(QLatin1String("void %1::%2(%3\n")).arg(adapteeClassName).arg(method->name())
-                .arg(method->isSimple() ? QString() : formatArguments(method, /* name */ true, /* hideOutput */ true) + QLatin1String(","));
-        result += spacing + spacing + QString(QLatin1String("const %1::%2ContextPtr &context)\n")).arg(getServiceAdaptor()).arg(method->nameAsIs());
+        const int currentMethodIndex = methodIndex++;
+        out << "void " << adapteeClassName << "::" << method->name() << '(';
+        if (!method->isSimple()) {
+            writeArguments(out, method, /* name */ true, /* hideOutput */ true);
+            out << ',';
+        }
+        out << '\n';
+        out.indent();
+        out.indent();
+        out << "const " << getServiceAdaptor() << "::" << method->nameAsIs() << "ContextPtr &context)\n";
+        out.unindent();
+        out.unindent();
 
-        result += QLatin1String("{\n");
+        out << "{\n";
+        out.indent();
 
-        result += spacing + QString(QLatin1String("debug() << \"%1::%2\";\n")).arg(adapteeClassName).arg(method->name());
-        result += spacing + QLatin1String("DBusError error;\n");
+        generateTraceBegin(out, method);
 
-        QStringList outputVarNames;
+        if (hasOption(MethodStatistics)) {
+            out << "QElapsedTimer statisticsTimer;\n";
+            out << "statisticsTimer.start();\n";
+        }
 
-        foreach (int outputArgumentIndex, method->outputArgsIndices()) {
-            outputVarNames.append(method->arguments.at(outputArgumentIndex).name());
+        if (hasOption(AsyncMethodDispatch)) {
+            // The interface finishes the context, now or later.
+            out << m_adapteeParentMember << "->" << method->name() << '(';
+            if (method->inputArgsCount()) {
+                writeArguments(out, method, /* argName */ true, /* hideOutputArguments */ true, /* addType */ false);
+                out << ", ";
+            }
+            out << "context);\n";
+            generateTraceEnd(out, method);
+
+            if (hasOption(MethodStatistics)) {
+                // The errors are only known when the context is finished.
+                out << "recordMethodCall(" << currentMethodIndex << ", statisticsTimer.nsecsElapsed(), false);\n";
+            }
+
+            out.unindent();
+            out << "}\n";
+            out << '\n';
+            continue;
         }
 
-        if (method->outputArgsIndices().count() == 1) {
-            result += spacing + QString(QLatin1String("%1 %2 = ")).arg(method->callbackRetType()).arg(outputVarNames.first());
-        } else {
-            if (method->outputArgsIndices().count() > 1) {
-                foreach (int outputArgumentIndex, method->outputArgsIndices()) {
-                    const CMethodArgument &argument = method->arguments.at(outputArgumentIndex);
-                    result += spacing + QString(QLatin1String("%1 %2;\n")).arg(argument.type()).arg(argument.name());
-                }
+        out << "DBusError error;\n";
+
+        const QList<uint> outputArgsIndices = method->outputArgsIndices();
 
-                result += QLatin1Char('\n');
+        if (outputArgsIndices.count() == 1) {
+            out << method->callbackRetType() << ' ' << method->arguments.at(outputArgsIndices.first()).name() << " = ";
+        } else if (outputArgsIndices.count() > 1) {
+            foreach (int outputArgumentIndex, outputArgsIndices) {
+                const CMethodArgument &argument = method->arguments.at(outputArgumentIndex);
+                out << argument.type() << ' ' << argument.name() << ";\n";
             }
-            result += spacing;
+
+            out << '\n';
         }
 
-        result += m_adapteeParentMember + QString(QLatin1String("->%1(%2&error);\n")).arg(method->name())
-                .arg(method->isSimple() ? QString() : formatArguments(method, /* argName */ true,
-                                                                      /* hideOutputArguments */ (method->outputArgsIndices().count() == 1),
-                                                                      /* addType */ false) + QLatin1String(", "));
+        out << m_adapteeParentMember << "->" << method->name() << '(';
+        if (!method->isSimple()) {
+            writeArguments(out, method, /* argName */ true,
+                           /* hideOutputArguments */ (outputArgsIndices.count() == 1),
+                           /* addType */ false);
+            out << ", ";
+        }
+        out << "&error);\n";
+        generateTraceEnd(out, method);
 
-        result += spacing + QLatin1String("if (error.isValid()) {\n");
-        result += spacing + spacing + QLatin1String("context->setFinishedWithError(error.name(), error.message());\n");
-        result += spacing + spacing + QLatin1String("return;\n");
-        result += spacing + QLatin1String("}\n");
+        if (hasOption(MethodStatistics)) {
+            out << "recordMethodCall(" << currentMethodIndex << ", statisticsTimer.nsecsElapsed(), error.isValid());\n";
+        }
 
-        result += spacing + QString(QLatin1String("context->setFinished(%1);\n")).arg(outputVarNames.join(QLatin1String(", ")));
+        out << "if (error.isValid()) {\n";
+        out.indent();
+        out << "context->setFinishedWithError(error.name(), error.message());\n";
+        out << "return;\n";
+        out.unindent();
+        out << "}\n";
+
+        out << "context->setFinished(";
+        for (int i = 0; i < outputArgsIndices.count(); ++i) {
+            if (i) {
+                out << ", ";
+            }
+            out << method->arguments.at(outputArgsIndices.at(i)).name();
+        }
+        out << ");\n";
 
-        result += QLatin1String("}\n");
-        result += QLatin1Char('\n');
+        out.unindent();
+        out << "}\n";
+        out << '\n';
     }
-
-    return result;
 }
 
-QString CInterfaceGenerator::generateImplementationPrivate() const
+void CInterfaceGenerator::generateImplementationPrivate(CCodeEmitter &out) const
 {
-    QString result;
-
     // Private
-    result += QString(QLatin1String("struct TP_QT_NO_EXPORT %1::Private {\n")).arg(className());
+    out << "struct TP_QT_NO_EXPORT " << className() << "::Private {\n";
+    out.indent();
 
     if (m_immutablePropertiesCount) {
-        result += spacing + QString(QLatin1String("Private(%1 *parent,\n")).arg(className());
-        static const int privateSpacing = spacing.size() + QString(QLatin1String("Private(")).size();
-
-        result += QString(privateSpacing, QLatin1Char(' '));
+        out << "Private(";
+        const int privateSpacing = out.column();
+        out << className() << " *parent,";
+        out.newLineAligned(privateSpacing);
 
-        result += generateImmutablePropertiesListHelper(privateSpacing, /* names */ true, /* signature */ true);
-        result += QLatin1String(")\n");
+        generateImmutablePropertiesListHelper(out, privateSpacing, /* names */ true, /* signature */ true);
+        out << ")\n";
     } else {
-        result += spacing + QString(QLatin1String("Private(%1 *parent)\n")).arg(className());
+        out << "Private(" << className() << " *parent)\n";
     }
 
-    QString creatorLine;
+    out.indent();
+    out << ": ";
+    const int initializerColumn = out.column();
+    generatePrivateConstructorPropertiesList(out, initializerColumn);
+    if (hasOption(InlineAdaptee)) {
+        out << "adapteeObject(parent),";
+        out.newLineAligned(initializerColumn);
+        out << "adaptee(&adapteeObject)";
+    } else {
+        out << "adaptee(new " << className() << "::Adaptee(parent))";
+    }
 
-    creatorLine = spacing + spacing + QLatin1String(": ");
-    result += creatorLine;
-    result += generatePrivateConstructorPropertiesList(creatorLine.size());
-    result += QString(QLatin1String("adaptee(new %1::Adaptee(parent))\n")).arg(className());
+    if (m_coalescedPropertiesCount) {
+        foreach (const CInterfaceProperty *prop, m_properties) {
+            if (isCoalescedProperty(prop)) {
+                out << ',';
+                out.newLineAligned(initializerColumn);
+                out << prop->name() << "Changed(false)";
+            }
+        }
+        out << ',';
+        out.newLineAligned(initializerColumn);
+        out << "propertyChangesCommitScheduled(false)";
+    }
+    out << '\n';
+    out.unindent();
 
-    result += spacing + QLatin1String("{\n");
-    result += spacing + QLatin1String("}\n");
+    out << "{\n";
+    out << "}\n";
 
-    result += QLatin1Char('\n');
+    out << '\n';
 
     // Private members
     foreach (const CInterfaceProperty *prop, m_properties) {
-        result += spacing + QString(QLatin1String("%1 %2;\n")).arg(prop->type()).arg(prop->name());
+        if (hasAtomicStorage(prop)) {
+            out << "std::atomic<" << prop->type() << "> " << prop->name() << ";\n";
+        } else if (hasSnapshotStorage(prop)) {
+            // Replaced as a whole by the setters, so the readers only need an atomic pointer load.
+            out << "std::shared_ptr<" << templateArgument(QLatin1String("const ") + prop->type()) << "> " << prop->name() << ";\n";
+        } else {
+            out << prop->type() << ' ' << prop->name() << ";\n";
+        }
     }
 
     // Methods
     foreach (const CInterfaceMethod *method, m_methods) {
-        result += spacing + QString(QLatin1String("%1 %2;\n")).arg(method->callbackType()).arg(method->callbackMember());
+        out << method->callbackType() << ' ' << method->callbackMember() << ";\n";
     }
 
-    result += spacing + QString(QLatin1String("%1::Adaptee *adaptee;\n")).arg(className());
-    result += QLatin1String("};\n");
-    result += QLatin1Char('\n');
+    if (hasOption(CacheImmutableProperties)) {
+        out << "QVariantMap immutablePropertiesCache;\n";
+    }
 
-    return result;
+    if (hasOption(InlineAdaptee)) {
+        // Destroyed with the Private, before the QObject parent would delete it.
+        out << className() << "::Adaptee adapteeObject;\n";
+    }
+    out << className() << "::Adaptee *adaptee;\n";
+
+    if (m_coalescedPropertiesCount) {
+        // Dirty bits of the properties waiting for the next commitPropertyChanges()
+        foreach (const CInterfaceProperty *prop, m_properties) {
+            if (isCoalescedProperty(prop)) {
+                out << "bool " << prop->name() << "Changed;\n";
+            }
+        }
+        out << "bool propertyChangesCommitScheduled;\n";
+    }
+    out.unindent();
+    out << "};\n";
+    out << '\n';
 }
 
-QString CInterfaceGenerator::generateImplementationInterface() const
+void CInterfaceGenerator::generateImplementationInterface(CCodeEmitter &out) const
 {
-    QString result;
-
-    QString creatorLine;
-    QString creatorSpacingStr;
-
     static const QLatin1String commentHeader = QLatin1String(
                 "/**\n"
                 " * \\class %1\n"
@@ -935,162 +1217,205 @@ QString CInterfaceGenerator::generateImplementationInterface() const
                 " * \\return The immutable properties of this interface.\n"
                 " */\n");
 
-    result += QString(commentHeader).arg(className()).arg(docGroup()).arg(classBaseType().toLower()).arg(classBaseType()).arg(fullName());
+    out << QString(commentHeader).arg(className(), docGroup(), classBaseType().toLower(), classBaseType(), fullName());
 
     // Interface Constructor
-    result += commentClassConstructor;
-    creatorLine = QString(QLatin1String("%1::%1(")).arg(className());
-    result += creatorLine;
-    result += generateImmutablePropertiesListHelper(creatorLine.size(), /* names */ true, /* signatures */ true);
-    result += QLatin1String(")\n");
-    creatorLine = spacing + QLatin1String(": ");
-    creatorSpacingStr = QString(creatorLine.size(), QLatin1Char(' '));
-    result += creatorLine;
-
-    result += QString(QLatin1String("Abstract%1Interface(%2),\n")).arg(parentClassPrefix()).arg(interfaceTpDefinition());
+    out << commentClassConstructor;
+    out << className() << "::" << className() << '(';
+    generateImmutablePropertiesListHelper(out, out.column(), /* names */ true, /* signatures */ true);
+    out << ")\n";
+    out.indent();
+    out << ": ";
+    const int initializerColumn = out.column();
+
+    out << "Abstract" << parentClassPrefix() << "Interface(";
+    if (hasOption(StaticNameTable)) {
+        out << namesTable() << "::InterfaceName";
+    } else {
+        out << interfaceTpDefinition();
+    }
+    out << "),";
+    out.newLineAligned(initializerColumn);
 
     if (m_immutablePropertiesCount) {
-        result += creatorSpacingStr;
-        result += QString(QLatin1String("mPriv(new Private(this, %1))\n")).arg(generateImmutablePropertiesListHelper(-1 /* mean no-new-lines */, /* names */ true, /* signatures */ false));
+        out << "mPriv(new Private(this, ";
+        generateImmutablePropertiesListHelper(out, -1 /* mean no-new-lines */, /* names */ true, /* signatures */ false);
+        out << "))\n";
     } else {
-        result += creatorSpacingStr + QLatin1String("mPriv(new Private(this))\n");
+        out << "mPriv(new Private(this))\n";
     }
+    out.unindent();
 
-    result += QLatin1String("{\n");
-    result += QLatin1String("}\n");
-    result += QLatin1Char('\n');
+    out << "{\n";
+    out << "}\n";
+    out << '\n';
 
     // Interface Destructor
-    result += commentClassDestructor;
-    result += QString(QLatin1String("%1::~%1()\n")).arg(className());
-    result += QLatin1String("{\n");
-    result += spacing + QLatin1String("delete mPriv;\n");
-    result += QLatin1String("}\n");
-    result += QLatin1Char('\n');
+    out << commentClassDestructor;
+    out << className() << "::~" << className() << "()\n";
+    out << "{\n";
+    out.indent();
+    out << "delete mPriv;\n";
+    out.unindent();
+    out << "}\n";
+    out << '\n';
 
     // Interface immutableProperties()
-    result += commentMethodImmutableProperties;
-    result += QString(QLatin1String("QVariantMap %1::immutableProperties() const\n")).arg(className());
-    result += QLatin1String("{\n");
-    result += spacing + QLatin1String("QVariantMap map;\n");
+    out << commentMethodImmutableProperties;
+    out << "QVariantMap " << className() << "::immutableProperties() const\n";
+    out << "{\n";
+    out.indent();
+
+    if (hasOption(CacheImmutableProperties)) {
+        // The properties can not change, so the map is built on the first call only.
+        if (m_immutablePropertiesCount) {
+            out << "if (mPriv->immutablePropertiesCache.isEmpty()) {\n";
+            out.indent();
+
+            foreach (const CInterfaceProperty *prop, m_properties) {
+                if (!prop->isImmutable() || hasOption(StaticNameTable)) {
+                    continue;
+                }
 
-    if (m_immutablePropertiesCount) {
-        creatorLine = spacing + QLatin1String("map.insert(");
-        creatorSpacingStr = QString(creatorLine.size(), QLatin1Char(' '));
-    }
+                out << "static const QString " << prop->name() << "Key = "
+                    << interfaceTpDefinition() << " + QLatin1String(\"." << prop->nameAsIs() << "\");\n";
+            }
 
-    foreach (const CInterfaceProperty *prop, m_properties) {
-        if (!prop->isImmutable()) {
-            continue;
-        }
+            generateImmutablePropertiesInserts(out, QLatin1String("mPriv->immutablePropertiesCache"), /* staticKeys */ true);
 
-        // Unchangeable properties considered as immutable, but should not be listed in this list
-        if (prop->isUnchangeable()) {
-//            continue;
+            out.unindent();
+            out << "}\n";
         }
 
-        result += creatorLine + QString(QLatin1String("%1 + QLatin1String(\".%2\"),\n")).arg(interfaceTpDefinition()).arg(prop->nameAsIs());
-        result += creatorSpacingStr + QString(QLatin1String("QVariant::fromValue(%1));\n")).arg(prop->dbusGetter());
+        out << "return mPriv->immutablePropertiesCache;\n";
+    } else {
+        out << "QVariantMap map;\n";
+        generateImmutablePropertiesInserts(out, QLatin1String("map"), /* staticKeys */ false);
+        out << "return map;\n";
     }
-    result += spacing + QLatin1String("return map;\n");
-    result += QLatin1String("}\n");
-    result += QLatin1Char('\n');
+    out.unindent();
+    out << "}\n";
+    out << '\n';
 
     // Interface properties
     foreach (const CInterfaceProperty *prop, m_properties) {
-        result += QString(QLatin1String("%1 %2::%3() const\n")).arg(prop->type()).arg(className()).arg(prop->name());
-        result += QLatin1String("{\n");
-        result += spacing + QString(QLatin1String("return mPriv->%1;\n")).arg(prop->name());
-        result += QLatin1String("}\n");
-        result += QLatin1Char('\n');
+        out << prop->type() << ' ' << className() << "::" << prop->name() << "() const\n";
+        out << "{\n";
+        out.indent();
+        out << "return " << storedValue(prop) << ";\n";
+        out.unindent();
+        out << "}\n";
+        out << '\n';
 
         if (!prop->isImmutable()) {
             if (prop->notifier()) {
-                result += QString(QLatin1String("void %1::set%2(%3)\n")).arg(className()).arg(prop->nameFirstCapital()).arg(formatArguments(prop->notifier(), /* addName*/ true));
-
-                result += QLatin1String("{\n");
-                if (prop->notifier()->isSimple()) {
-                    result += spacing + QString(QLatin1String("if (mPriv->%1 == %2) {\n")).arg(prop->name()).arg(prop->notifier()->arguments.first().name());;
-                    result += spacing + spacing + QLatin1String("return;\n");
-                    result += spacing + QLatin1String("}\n\n");
+                out << "void " << className() << "::set" << prop->nameFirstCapital() << '(';
+                writeArguments(out, prop->notifier(), /* addName*/ true);
+                out << ")\n";
+
+                out << "{\n";
+                out.indent();
+                // The notifier describes a change of the property, so an unchanged value means nothing to announce.
+                if (prop->notifier()->isSimple() || (hasOption(CompareBeforeAssign) && prop->isComparable())) {
+                    out << "if (" << storedValue(prop) << " == " << prop->notifier()->arguments.first().name() << ") {\n";
+                    out.indent();
+                    out << "return;\n";
+                    out.unindent();
+                    out << "}\n\n";
                 }
-                result += spacing + QString(QLatin1String("mPriv->%1 = %2;\n")).arg(prop->name()).arg(prop->notifier()->arguments.first().name());;
-                if (compatibleWithQt4) {
-                    result += spacing + QString(QLatin1String("QMetaObject::invokeMethod(mPriv->adaptee, \"%1\"%2); //Can simply use emit in Qt5\n"))
-                            .arg(prop->notifier()->name()).arg(formatInvokeMethodArguments(prop->notifier()));
-                } else {
-                    result += spacing + QString(QLatin1String("emit mPriv->adaptee->%1();\n")).arg(prop->notifier()->name());
-                }
-                result += QLatin1String("}\n");
-                result += QLatin1Char('\n');
+                out << storeValue(prop, prop->notifier()->arguments.first().name()) << ";\n";
+                generateSignalEmission(out, prop->notifier());
+                out.unindent();
+                out << "}\n";
+                out << '\n';
 
             } else {
-                result += QString(QLatin1String("void %1::set%2(%3)\n")).arg(className()).arg(prop->nameFirstCapital()).arg(prop->formatTypeArgument(/* addName*/ true));
-
-                result += QLatin1String("{\n");
-                result += spacing + QString(QLatin1String("mPriv->%1 = %1;\n")).arg(prop->name());
+                generatePropertySetter(out, prop, /* rvalue */ false);
 
-                if (m_emitPropertiesChangedSignal) {
-                    result += spacing + QString(QLatin1String("notifyPropertyChanged(QLatin1String(\"%1\"), QVariant::fromValue(%2));\n")).arg(prop->nameAsIs()).arg(prop->name());
+                if (hasRvalueSetter(prop)) {
+                    generatePropertySetter(out, prop, /* rvalue */ true);
                 }
-                result += QLatin1String("}\n");
-                result += QLatin1Char('\n');
             }
         }
     }
 
-    result += QString(QLatin1String("void %1::createAdaptor()\n")).arg(className());
-    result += QLatin1String("{\n");
-    result += spacing + QString(QLatin1String("(void) new %1(dbusObject()->dbusConnection(),\n")).arg(getServiceAdaptor());
-    result += spacing + spacing + spacing + QLatin1String("mPriv->adaptee, dbusObject());\n");
-    result += QLatin1String("}\n");
-    result += QLatin1Char('\n');
+    if (m_coalescedPropertiesCount) {
+        generatePropertyChangesCommit(out);
+    }
+
+    out << "void " << className() << "::createAdaptor()\n";
+    out << "{\n";
+    out.indent();
+    out << "(void) new " << getServiceAdaptor() << "(dbusObject()->dbusConnection(),\n";
+    out.indent();
+    out.indent();
+    out << "mPriv->adaptee, dbusObject());\n";
+    out.unindent();
+    out.unindent();
+    out.unindent();
+    out << "}\n";
+    out << '\n';
 
     // Methods
     foreach (const CInterfaceMethod *method, m_methods) {
-        result += QString(QLatin1String("void %1::set%2Callback(const %3 &cb)\n")).arg(className()).arg(method->nameFirstCapital()).arg(method->callbackType());
-        result += QLatin1String("{\n");
-        result += spacing + QString(QLatin1String("mPriv->%1 = cb;\n")).arg(method->callbackMember());
-        result += QLatin1String("}\n");
-        result += QLatin1Char('\n');
+        out << "void " << className() << "::set" << method->nameFirstCapital() << "Callback(const " << method->callbackType() << " &cb)\n";
+        out << "{\n";
+        out.indent();
+        out << "mPriv->" << method->callbackMember() << " = cb;\n";
+        out.unindent();
+        out << "}\n";
+        out << '\n';
+
+        if (hasOption(AsyncMethodDispatch)) {
+            generateAsyncMethodImplementation(out, method);
+            continue;
+        }
 
-        QString checkStr = QLatin1String("{\n");
-        checkStr += spacing + QString(QLatin1String("if (!mPriv->%1.isValid()) {\n")).arg(method->callbackMember());
-        checkStr += spacing + spacing + QLatin1String("error->set(TP_QT_ERROR_NOT_IMPLEMENTED, QLatin1String(\"Not implemented\"));\n");
+        int outputArgsCount = 0;
 
-        // FIXME: It's bad to check ret type for "void" and it's really bad to blindly add () for arg type otherwise. (Will not work for POD)
-        if (method->callbackRetType() == QLatin1String("void")) {
-            checkStr += spacing + spacing + QLatin1String("return;\n");
-        } else {
-            checkStr += spacing + spacing + QString(QLatin1String("return %1();\n")).arg(method->callbackRetType());
+        for (int i = 0; i < method->arguments.count(); ++i) {
+            if (method->arguments.at(i).direction() == CMethodArgument::Output) {
+                ++outputArgsCount;
+            }
+        }
+
+        out << method->callbackRetType() << ' ' << className() << "::" << method->name() << '(';
+        if (!method->isSimple()) {
+            writeArguments(out, method, /* addName*/ true, /* hideOutputArguments */ (outputArgsCount <= 1));
+            out << ", ";
         }
+        out << "DBusError *error)\n";
 
-        checkStr += spacing + QLatin1String("}\n");
+        out << "{\n";
+        out.indent();
+        out << "if (!mPriv->" << method->callbackMember() << ".isValid()) {\n";
+        out.indent();
+        out << "error->set(TP_QT_ERROR_NOT_IMPLEMENTED, QLatin1String(\"Not implemented\"));\n";
 
-        if (method->isSimple()) {
-            result += QString(QLatin1String("%1 %2::%3(DBusError *error)\n"))
-                    .arg(method->callbackRetType()).arg(className()).arg(method->name());
-            result += checkStr;
-            result += spacing + QString(QLatin1String("return mPriv->%1(error);\n")).arg(method->callbackMember());
+        // FIXME: It's bad to check ret type for "void" and it's really bad to blindly add () for arg type otherwise. (Will not work for POD)
+        if (method->callbackRetType() == QLatin1String("void")) {
+            out << "return;\n";
         } else {
-            int outputArgsCount = 0;
+            out << "return " << method->callbackRetType() << "();\n";
+        }
 
-            for (int i = 0; i < method->arguments.count(); ++i) {
-                if (method->arguments.at(i).direction() == CMethodArgument::Output) {
-                    ++outputArgsCount;
-                }
-            }
+        out.unindent();
+        out << "}\n";
 
-            result += QString(QLatin1String("%1 %2::%3(%4, DBusError *error)\n"))
-                    .arg(method->callbackRetType()).arg(className()).arg(method->name())
-                    .arg(formatArguments(method, /* addName*/ true, /* hideOutputArguments */ (outputArgsCount <= 1)));
-            result += checkStr;
-            result += spacing + QString(QLatin1String("return mPriv->%1(%2, error);\n")).arg(method->callbackMember())
-                    .arg(formatArguments(method, /* addName*/ true, /* hideOutputArguments */ (outputArgsCount <= 1), /* addType */ false));
+        out << "return mPriv->" << method->callbackMember() << '(';
+        if (!method->isSimple()) {
+            writeArguments(out, method, /* addName*/ true, /* hideOutputArguments */ (outputArgsCount <= 1), /* addType */ false);
+            out << ", ";
         }
+        out << "error);\n";
+
+        out.unindent();
+        out << "}\n";
+        out << '\n';
+    }
 
-        result += QLatin1String("}\n");
-        result += QLatin1Char('\n');
+    if (hasOption(MethodStatistics)) {
+        generateMethodStatisticsGetter(out);
     }
 
     // Signals
@@ -1099,82 +1424,439 @@ QString CInterfaceGenerator::generateImplementationInterface() const
             continue;
         }
 
-        result += QString(QLatin1String("void %1::%2(%3)\n")).arg(className()).arg(sig->name()).arg(formatArguments(sig, /* argName */ true));
-        result += QLatin1String("{\n");
-        if (compatibleWithQt4) {
-            result += spacing + QString(QLatin1String("QMetaObject::invokeMethod(mPriv->adaptee, \"%1\"%2); //Can simply use emit in Qt5\n")).arg(sig->name()).arg(formatInvokeMethodArguments(sig));
+        out << "void " << className() << "::" << sig->name() << '(';
+        writeArguments(out, sig, /* argName */ true);
+        out << ")\n";
+        out << "{\n";
+        out.indent();
+        generateSignalEmission(out, sig);
+        out.unindent();
+        out << "}\n";
+        out << '\n';
+    }
+}
+
+QString CInterfaceGenerator::namesTable() const
+{
+    return className() + QLatin1String("Names");
+}
+
+QString CInterfaceGenerator::propertyNameKey(const CInterfaceProperty *prop) const
+{
+    if (hasOption(StaticNameTable)) {
+        return namesTable() + QLatin1String("::Property_") + prop->nameAsIs();
+    }
+
+    return QString(QLatin1String("QLatin1String(\"%1\")")).arg(prop->nameAsIs());
+}
+
+void CInterfaceGenerator::generateNamesTable(CCodeEmitter &out) const
+{
+    // QStringLiteral data is built at compile time, so the table costs no allocation or conversion.
+    // The prefixes keep the property constants apart from InterfaceName and from each other.
+    out << '\n';
+    out << "namespace {\n";
+    out << "namespace " << namesTable() << " {\n";
+    out << '\n';
+    out << "const QString InterfaceName = QStringLiteral(\"" << m_dbusName << "\");\n";
+
+    foreach (const CInterfaceProperty *prop, m_properties) {
+        out << "const QString Property_" << prop->nameAsIs() << " = QStringLiteral(\"" << prop->nameAsIs() << "\");\n";
+        out << "const QString QualifiedProperty_" << prop->nameAsIs() << " = QStringLiteral(\""
+            << m_dbusName << '.' << prop->nameAsIs() << "\");\n";
+    }
+
+    out << '\n';
+    out << "}\n";
+    out << "}\n";
+    out << '\n';
+}
+
+void CInterfaceGenerator::generatePropertySetter(CCodeEmitter &out, const CInterfaceProperty *prop, bool rvalue) const
+{
+    out << "void " << className() << "::set" << prop->nameFirstCapital() << '(';
+    if (rvalue) {
+        out << prop->formatRvalueTypeArgument(/* addName*/ true);
+    } else {
+        out << prop->formatTypeArgument(/* addName*/ true);
+    }
+    out << ")\n";
+
+    out << "{\n";
+    out.indent();
+    if (hasOption(CompareBeforeAssign) && prop->isComparable()) {
+        out << "if (" << storedValue(prop) << " == " << prop->name() << ") {\n";
+        out.indent();
+        out << "return;\n";
+        out.unindent();
+        out << "}\n\n";
+    }
+    if (rvalue) {
+        out << storeValue(prop, QLatin1String("std::move(") + prop->name() + QLatin1Char(')')) << ";\n";
+    } else {
+        out << storeValue(prop, prop->name()) << ";\n";
+    }
+
+    if (isCoalescedProperty(prop)) {
+        out << "mPriv->" << prop->name() << "Changed = true;\n";
+        out << "schedulePropertyChangesCommit();\n";
+    } else if (m_emitPropertiesChangedSignal) {
+        // The argument is moved-from in the rvalue setter, so the stored value is announced.
+        out << "notifyPropertyChanged(" << propertyNameKey(prop) << ", QVariant::fromValue("
+            << (rvalue ? storedValue(prop) : prop->name()) << "));\n";
+    }
+    out.unindent();
+    out << "}\n";
+    out << '\n';
+}
+
+void CInterfaceGenerator::generatePropertyChangesCommit(CCodeEmitter &out) const
+{
+    static const QLatin1String commentMethodCommitPropertyChanges = QLatin1String(
+                "/**\n"
+                " * Emit one PropertiesChanged signal with all properties changed since the last commit.\n"
+                " *\n"
+                " * The commit is scheduled for the next event loop iteration by the property setters,\n"
+                " * so this method only needs to be called to announce the changes immediately.\n"
+                " */\n");
+
+    out << commentMethodCommitPropertyChanges;
+    out << "void " << className() << "::commitPropertyChanges()\n";
+    out << "{\n";
+    out.indent();
+    out << "mPriv->propertyChangesCommitScheduled = false;\n";
+    out << '\n';
+    out << "QVariantMap changedProperties;\n";
+
+    foreach (const CInterfaceProperty *prop, m_properties) {
+        if (!isCoalescedProperty(prop)) {
+            continue;
+        }
+
+        out << "if (mPriv->" << prop->name() << "Changed) {\n";
+        out.indent();
+        if (hasOption(StaticNameTable)) {
+            out << "changedProperties.insert(" << propertyNameKey(prop) << ", QVariant::fromValue(" << storedValue(prop) << "));\n";
         } else {
-            result += spacing + QString(QLatin1String("emit mPriv->adaptee->%1();\n")).arg(sig->name());
+            out << "static const QString " << prop->name() << "Key = QLatin1String(\"" << prop->nameAsIs() << "\");\n";
+            out << "changedProperties.insert(" << prop->name() << "Key, QVariant::fromValue(" << storedValue(prop) << "));\n";
         }
-        result += QLatin1String("}\n");
-        result += QLatin1Char('\n');
+        out << "mPriv->" << prop->name() << "Changed = false;\n";
+        out.unindent();
+        out << "}\n";
     }
 
-    return result;
+    out << '\n';
+    out << "if (changedProperties.isEmpty() || !isRegistered()) {\n";
+    out.indent();
+    out << "return;\n";
+    out.unindent();
+    out << "}\n";
+    out << '\n';
+    out << "QDBusMessage signal = QDBusMessage::createSignal(";
+    const int createSignalColumn = out.column();
+    out << "dbusObject()->objectPath(),";
+    out.newLineAligned(createSignalColumn);
+    out << "TP_QT_IFACE_PROPERTIES,";
+    out.newLineAligned(createSignalColumn);
+    if (hasOption(StaticNameTable)) {
+        out << "QStringLiteral(\"PropertiesChanged\"));\n";
+    } else {
+        out << "QLatin1String(\"PropertiesChanged\"));\n";
+    }
+    out << "signal << interfaceName() << changedProperties << QStringList();\n";
+    out << "dbusObject()->dbusConnection().send(signal);\n";
+    out.unindent();
+    out << "}\n";
+    out << '\n';
+
+    out << "void " << className() << "::schedulePropertyChangesCommit()\n";
+    out << "{\n";
+    out.indent();
+    out << "if (mPriv->propertyChangesCommitScheduled) {\n";
+    out.indent();
+    out << "return;\n";
+    out.unindent();
+    out << "}\n";
+    out << '\n';
+    out << "mPriv->propertyChangesCommitScheduled = true;\n";
+    out << "QMetaObject::invokeMethod(this, \"commitPropertyChanges\", Qt::QueuedConnection);\n";
+    out.unindent();
+    out << "}\n";
+    out << '\n';
+}
+
+void CInterfaceGenerator::generateAsyncMethodImplementation(CCodeEmitter &out, const CInterfaceMethod *method) const
+{
+    out << "void " << className() << "::" << method->name() << '(';
+    if (method->inputArgsCount()) {
+        writeArguments(out, method, /* addName*/ true, /* hideOutputArguments */ true);
+        out << ", ";
+    }
+    out << "const " << method->contextPtrType() << " &context)\n";
+
+    out << "{\n";
+    out.indent();
+    out << "if (!mPriv->" << method->callbackMember() << ".isValid()) {\n";
+    out.indent();
+    out << "context->setFinishedWithError(TP_QT_ERROR_NOT_IMPLEMENTED, QLatin1String(\"Not implemented\"));\n";
+    out << "return;\n";
+    out.unindent();
+    out << "}\n";
+
+    out << "mPriv->" << method->callbackMember() << '(';
+    if (method->inputArgsCount()) {
+        writeArguments(out, method, /* addName*/ true, /* hideOutputArguments */ true, /* addType */ false);
+        out << ", ";
+    }
+    out << "context);\n";
+
+    out.unindent();
+    out << "}\n";
+    out << '\n';
+}
+
+void CInterfaceGenerator::generateMethodStatisticsRecorder(CCodeEmitter &out) const
+{
+    const QString countersType = className() + QLatin1String("MethodCounters");
+    const QString countersTable = QLatin1String("s_") + countersType;
+
+    // Zero-initialized statics, shared by all instances of the interface.
+    out << "namespace {\n";
+    out << '\n';
+    out << "struct " << countersType << '\n';
+    out << "{\n";
+    out.indent();
+    out << "std::atomic<quint64> callCount;\n";
+    out << "std::atomic<quint64> errorCount;\n";
+    out << "std::atomic<quint64> latencyHistogram[" << className() << "::MethodStatistics::LatencyBucketCount];\n";
+    out.unindent();
+    out << "};\n";
+    out << '\n';
+    out << countersType << ' ' << countersTable << '[' << m_methods.count() << "];\n";
+    out << '\n';
+    out << "const char *const s_" << className() << "MethodNames[] = {\n";
+    out.indent();
+    foreach (const CInterfaceMethod *method, m_methods) {
+        out << '"' << method->nameAsIs() << "\",\n";
+    }
+    out.unindent();
+    out << "};\n";
+    out << '\n';
+    out << "}\n";
+    out << '\n';
+
+    out << "void " << className() << "::Adaptee::recordMethodCall(int methodIndex, qint64 elapsedNsecs, bool failed)\n";
+    out << "{\n";
+    out.indent();
+    out << countersType << " &counters = " << countersTable << "[methodIndex];\n";
+    out << "counters.callCount.fetch_add(1, std::memory_order_relaxed);\n";
+    out << "if (failed) {\n";
+    out.indent();
+    out << "counters.errorCount.fetch_add(1, std::memory_order_relaxed);\n";
+    out.unindent();
+    out << "}\n";
+    out << '\n';
+    out << "int bucket = 0;\n";
+    out << "for (qint64 limit = 10000; (bucket < " << className() << "::MethodStatistics::LatencyBucketCount - 1) && (elapsedNsecs >= limit); limit *= 10) {\n";
+    out.indent();
+    out << "++bucket;\n";
+    out.unindent();
+    out << "}\n";
+    out << "counters.latencyHistogram[bucket].fetch_add(1, std::memory_order_relaxed);\n";
+    out.unindent();
+    out << "}\n";
+    out << '\n';
+}
+
+void CInterfaceGenerator::generateMethodStatisticsGetter(CCodeEmitter &out) const
+{
+    static const QLatin1String commentMethodStatistics = QLatin1String(
+                "/**\n"
+                " * Return the call count, error count and latency histogram of each method of this interface,\n"
+                " * summed over all its instances.\n"
+                " */\n");
+
+    out << commentMethodStatistics;
+    out << "QList<" << className() << "::MethodStatistics> " << className() << "::methodStatistics()\n";
+    out << "{\n";
+    out.indent();
+    out << "QList<MethodStatistics> result;\n";
+
+    if (!m_methods.isEmpty()) {
+        const QString countersType = className() + QLatin1String("MethodCounters");
+
+        out << '\n';
+        out << "for (int i = 0; i < " << m_methods.count() << "; ++i) {\n";
+        out.indent();
+        out << "const " << countersType << " &counters = s_" << countersType << "[i];\n";
+        out << "MethodStatistics statistics;\n";
+        out << "statistics.name = QLatin1String(s_" << className() << "MethodNames[i]);\n";
+        out << "statistics.callCount = counters.callCount.load(std::memory_order_relaxed);\n";
+        out << "statistics.errorCount = counters.errorCount.load(std::memory_order_relaxed);\n";
+        out << "statistics.latencyHistogram.resize(MethodStatistics::LatencyBucketCount);\n";
+        out << "for (int bucket = 0; bucket < MethodStatistics::LatencyBucketCount; ++bucket) {\n";
+        out.indent();
+        out << "statistics.latencyHistogram[bucket] = counters.latencyHistogram[bucket].load(std::memory_order_relaxed);\n";
+        out.unindent();
+        out << "}\n";
+        out << "result.append(statistics);\n";
+        out.unindent();
+        out << "}\n";
+        out << '\n';
+    }
+
+    out << "return result;\n";
+    out.unindent();
+    out << "}\n";
+    out << '\n';
 }
 
-QString CInterfaceGenerator::generateMethodCallbackAndDeclaration(const CInterfaceMethod *method) const
+void CInterfaceGenerator::generateTraceBegin(CCodeEmitter &out, const CInterfaceMethod *method) const
 {
-    QList<uint> outputArgsIndices;
+    if (hasOption(TraceHook)) {
+        out << "TP_QT_ADAPTEE_TRACE_TIMER(traceTimer);\n";
+    } else if (hasOption(TraceMacro)) {
+        out << "TP_QT_ADAPTEE_TRACE(\"" << className() << "::Adaptee::" << method->name() << "\");\n";
+    } else {
+        out << "debug() << \"" << className() << "::Adaptee::" << method->name() << "\";\n";
+    }
+}
+
+void CInterfaceGenerator::generateTraceEnd(CCodeEmitter &out, const CInterfaceMethod *method) const
+{
+    if (!hasOption(TraceHook)) {
+        return;
+    }
 
-    for (int i = 0; i < method->arguments.count(); ++i) {
-        if (method->arguments.at(i).direction() == CMethodArgument::Output) {
-            outputArgsIndices.append(i);
+    // The size of the strings, arrays and dicts passed in, which all have size().
+    QStringList sizes;
+    foreach (const CMethodArgument &argument, method->arguments) {
+        if (argument.direction() != CMethodArgument::Input) {
+            continue;
+        }
+
+        if (argument.signature().startsWith(QLatin1Char('a')) || (argument.signature() == QLatin1String("s"))) {
+            sizes.append(argument.name() + QLatin1String(".size()"));
         }
     }
 
-    QString result = spacing + QLatin1String("typedef Callback");
+    if (sizes.isEmpty()) {
+        sizes.append(QLatin1String("0"));
+    }
+
+    out << "TP_QT_ADAPTEE_TRACE_HOOK(\"" << className() << "::Adaptee::" << method->name() << "\", "
+        << sizes.join(QLatin1String(" + ")) << ", traceTimer.nsecsElapsed());\n";
+}
 
-    if (method->isSimple()) {
-        result += QString(QLatin1String("1<%1, DBusError*> %2;\n")).arg(method->callbackRetType()).arg(method->callbackType());
+void CInterfaceGenerator::generateSignalEmission(CCodeEmitter &out, const CInterfaceSignal *sig) const
+{
+    if (hasOption(DirectSignalEmission)) {
+        out << "emit mPriv->adaptee->" << sig->name() << '(';
+        writeArguments(out, sig, /* addName */ true, /* hideOutputArguments */ false, /* addType */ false);
+        out << ");\n";
     } else {
-        result += QString(QLatin1String("%1<%2, %3, DBusError*> %4;\n"))
-                .arg(method->arguments.count() + (outputArgsIndices.isEmpty() ? 1 : 0))
-                .arg(method->callbackRetType()).arg(formatArguments(method, /* addName*/ false, /* hideOutputArguments */ true)).arg(method->callbackType());
+        // Qt4 has no public signals, so the adaptee signal is invoked by name.
+        out << "QMetaObject::invokeMethod(mPriv->adaptee, \"" << sig->name() << '"';
+        writeInvokeMethodArguments(out, sig);
+        out << "); //Can simply use emit in Qt5\n";
+    }
+}
+
+void CInterfaceGenerator::generateImmutablePropertiesInserts(CCodeEmitter &out, const QString &mapName, bool staticKeys) const
+{
+    foreach (const CInterfaceProperty *prop, m_properties) {
+        if (!prop->isImmutable()) {
+            continue;
+        }
+
+        // Unchangeable properties considered as immutable, but should not be listed in this list
+        if (prop->isUnchangeable()) {
+//            continue;
+        }
+
+        out << mapName << ".insert(";
+        const int insertColumn = out.column();
+        if (hasOption(StaticNameTable)) {
+            out << namesTable() << "::QualifiedProperty_" << prop->nameAsIs() << ',';
+        } else if (staticKeys) {
+            out << prop->name() << "Key,";
+        } else {
+            out << interfaceTpDefinition() << " + QLatin1String(\"." << prop->nameAsIs() << "\"),";
+        }
+        out.newLineAligned(insertColumn);
+        out << "QVariant::fromValue(" << prop->dbusGetter() << "));\n";
     }
+}
+
+void CInterfaceGenerator::generateMethodCallbackAndDeclaration(CCodeEmitter &out, const CInterfaceMethod *method) const
+{
+    const int outputArgsCount = method->outputArgsIndices().count();
+
+    if (hasOption(AsyncMethodDispatch)) {
+        out << "typedef Callback" << method->inputArgsCount() + 1 << "<void, ";
+        if (method->inputArgsCount()) {
+            writeArguments(out, method, /* addName*/ false, /* hideOutputArguments */ true);
+            out << ", ";
+        }
+        out << "const " << method->contextPtrType() << " &> " << method->callbackType() << ";\n";
+
+        out << "void set" << method->nameFirstCapital() << "Callback(const " << method->callbackType() << " &cb);\n";
 
-    result += spacing + QString(QLatin1String("void set%1Callback(const %2 &cb);\n")).arg(method->nameFirstCapital()).arg(method->callbackType());
+        out << "void " << method->name() << '(';
+        if (method->inputArgsCount()) {
+            writeArguments(out, method, /* addName*/ true, /* hideOutputArguments */ true);
+            out << ", ";
+        }
+        out << "const " << method->contextPtrType() << " &context);\n";
+        return;
+    }
+
+    out << "typedef Callback";
 
     if (method->isSimple()) {
-        result += spacing + QString(QLatin1String("%1 %2(DBusError *error);\n")).arg(method->callbackRetType()).arg(method->name());
+        out << "1<" << method->callbackRetType() << ", DBusError*> " << method->callbackType() << ";\n";
     } else {
-        result += spacing + QString(QLatin1String("%1 %2(%3, DBusError *error);\n")).arg(method->callbackRetType()).arg(method->name()).arg(formatArguments(method, /* addName*/ true, /* hideOutputArguments */ (outputArgsIndices.count() <= 1)));
+        out << method->arguments.count() + (outputArgsCount == 0 ? 1 : 0) << '<' << method->callbackRetType() << ", ";
+        writeArguments(out, method, /* addName*/ false, /* hideOutputArguments */ true);
+        out << ", DBusError*> " << method->callbackType() << ";\n";
     }
 
-    return result;
+    out << "void set" << method->nameFirstCapital() << "Callback(const " << method->callbackType() << " &cb);\n";
+
+    out << method->callbackRetType() << ' ' << method->name() << '(';
+    if (!method->isSimple()) {
+        writeArguments(out, method, /* addName*/ true, /* hideOutputArguments */ (outputArgsCount <= 1));
+        out << ", ";
+    }
+    out << "DBusError *error);\n";
 }
 
-QString CInterfaceGenerator::formatArguments(const CArgumentsFeature *argumentsClass, bool addName, bool hideOutputArguments, bool addType) const
+void CInterfaceGenerator::writeArguments(CCodeEmitter &out, const CArgumentsFeature *argumentsClass, bool addName, bool hideOutputArguments, bool addType) const
 {
-    QString result;
+    bool first = true;
 
     for (int i = 0; i < argumentsClass->arguments.count(); ++ i) {
         if (hideOutputArguments && argumentsClass->arguments.at(i).direction() == CMethodArgument::Output) {
             continue;
         }
 
-        if (!result.isEmpty()) {
-            result.append(QLatin1String(", "));
+        if (!first) {
+            out << ", ";
         }
+        first = false;
 
         if (addType) {
-            result += argumentsClass->arguments.at(i).formatArgument(addName);
+            out << argumentsClass->arguments.at(i).formatArgument(addName);
         } else {
-            result += argumentsClass->arguments.at(i).name();
+            out << argumentsClass->arguments.at(i).name();
         }
     }
-
-    return result;
 }
 
-QString CInterfaceGenerator::formatInvokeMethodArguments(const CArgumentsFeature *argumentsClass) const
+void CInterfaceGenerator::writeInvokeMethodArguments(CCodeEmitter &out, const CArgumentsFeature *argumentsClass) const
 {
-    QString result;
-
     foreach (const CMethodArgument &argument, argumentsClass->arguments) {
-        result.append(QLatin1String(", "));
-
-        result += QString(QLatin1String("Q_ARG(%1, %2)")).arg(argument.type()).arg(argument.name());
+        out << ", Q_ARG(" << argument.type() << ", " << argument.name() << ')';
     }
-    return result;
 }
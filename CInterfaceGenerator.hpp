@@ -1,9 +1,17 @@
 #ifndef CINTERFACEGENERATOR_HPP
 #define CINTERFACEGENERATOR_HPP
 
+#include <QHash>
 #include <QString>
+#include <QStringList>
 #include <QList>
 
+#include "CModelArena.hpp"
+#include "CSignatureParser.hpp"
+#include "CStringPool.hpp"
+
+class CCodeEmitter;
+
 class CNameFeature {
 public:
     CNameFeature() { }
@@ -13,6 +21,7 @@ public:
     QString nameFirstCapital() const;
 
     void setName(const QString &newName);
+    void internName(CStringPool *pool);
 
 private:
     QString m_name;
@@ -21,22 +30,39 @@ private:
 
 class CTypeFeature : public CNameFeature {
 public:
-    CTypeFeature() { }
+    enum TypeFlag {
+        NoTypeFlags = DBusTypeMapping::NoTypeFlags,
+        Pod = DBusTypeMapping::Pod,
+        NotComparable = DBusTypeMapping::NotComparable
+    };
+
+    CTypeFeature() : m_typeFlags(NoTypeFlags), m_typeError(CSignatureParser::NoError) { }
 
     QString type() const { return m_type; }
+    QString signature() const { return m_signature; }
     QString typeForAdaptee() const { return m_typeForAdaptee; }
     QString defaultValue() const { return m_defaultValue; }
+    uint typeFlags() const { return m_typeFlags; }
+    CSignatureParser::Error typeError() const { return m_typeError; }
 
-    void setTypeFromStr(const QString &type, const QString &tpType);
+    // The parser is used for the signatures without tp:type; pass one to share its results across the spec.
+    void setTypeFromStr(const QString &type, const QString &tpType, CSignatureParser *parser = 0);
 
-    bool isPod() const;
+    bool isPod() const { return m_typeFlags & Pod; }
+    bool isComparable() const { return !(m_typeFlags & NotComparable); }
     QString formatTypeArgument(bool addName) const;
+    QString formatRvalueTypeArgument(bool addName) const;
+
+    void internStrings(CStringPool *pool);
 
 private:
     QString supposeType(const QString &type, QString tpType) const;
+    QString m_signature;
     QString m_type;
     QString m_typeForAdaptee;
     QString m_defaultValue;
+    uint m_typeFlags;
+    CSignatureParser::Error m_typeError;
 
 };
 
@@ -108,6 +134,8 @@ public:
     QString callbackRetType() const { return m_callbackRetType; }
 
     QList<uint> outputArgsIndices() const { return m_outputArgsIndices; }
+    int inputArgsCount() const;
+    QString contextPtrType() const;
 
     void prepare();
 
@@ -139,6 +167,22 @@ public:
         InterfaceSubTypeInterface
     };
 
+    enum GenerationOption {
+        NoGenerationOptions = 0,
+        CacheImmutableProperties = 1 << 0, // Build the immutableProperties() map once, with static keys
+        DirectSignalEmission = 1 << 1, // Qt5 target: emit adaptee signals directly instead of QMetaObject::invokeMethod()
+        CoalescePropertyChanges = 1 << 2, // Collect property changes into one PropertiesChanged signal per event loop iteration
+        MoveAwareSetters = 1 << 3, // Add rvalue reference overloads to setters of non-POD properties
+        CompareBeforeAssign = 1 << 4, // Setters return early if the new value equals the stored one
+        AsyncMethodDispatch = 1 << 5, // Method callbacks get the invocation context and finish it themselves
+        TraceMacro = 1 << 6, // Trace adaptee methods with a macro that is compiled out in release builds
+        TraceHook = 1 << 7, // Report the method name, arguments size and callback time of adaptee methods to a hook
+        MethodStatistics = 1 << 8, // Count the calls, errors and latencies of every method in a static table
+        InlineAdaptee = 1 << 9, // Keep the adaptee in the Private struct instead of allocating it separately
+        ThreadSafeProperties = 1 << 10, // Store mutable properties in std::atomic or atomically replaced std::shared_ptr
+        StaticNameTable = 1 << 11 // Use a per-interface table of QStringLiteral names instead of building them at runtime
+    };
+
     CInterfaceGenerator();
 
     SpecFormat specFormat() const;
@@ -162,24 +206,47 @@ public:
 
     QString shortName() const;
     QString fullName() const { return m_fullName; }
+    QString dbusName() const { return m_dbusName; }
 
     QString node() const { return m_node; }
     QString nodeName() const { return m_nodeName; }
     void setNode(const QString &node);
+    void setNodeName(const QString &nodeName) { m_nodeName = nodeName; } // Overrides the one of setNode()
 
     void setType(const QString &classBaseType);
     void setSubType(InterfaceSubType subType);
     void setEmitPropertiesChangedSignal(bool enable);
 
+    uint options() const { return m_options; }
+    void setOptions(uint options);
+    bool hasOption(GenerationOption option) const;
+
+    // The model objects are owned by the generator and released together by clearModel() or the destructor.
+    CInterfaceProperty *createProperty();
+    CInterfaceMethod *createMethod(const QString &name);
+    CInterfaceSignal *createSignal(const QString &name);
+    void clearModel();
+
+    CStringPool *stringPool() { return &m_stringPool; }
+
+    // The tp:type names used by the interface, without the array suffix.
+    QStringList referencedTypes() const { return m_referencedTypes; }
+    void addReferencedType(const QString &typeName);
+
+    // The spec file the interface is read from, if known.
+    QString specFileName() const { return m_specFileName; }
+    void setSpecFileName(const QString &fileName) { m_specFileName = fileName; }
+
     void prepare();
-    QString generateHeaderInterface() const;
-    QString generateHeaderAdaptee() const;
 
-    QString generateImplementationAdaptee() const;
-    QString generateImplementationPrivate() const;
-    QString generateImplementationInterface() const;
+    void generateHeaderInterface(CCodeEmitter &out) const;
+    void generateHeaderAdaptee(CCodeEmitter &out) const;
+
+    void generateImplementationAdaptee(CCodeEmitter &out) const;
+    void generateImplementationPrivate(CCodeEmitter &out) const;
+    void generateImplementationInterface(CCodeEmitter &out) const;
 
-    QString generateImplementations() const;
+    void generateImplementations(CCodeEmitter &out) const;
 
     QString getServiceAdaptor() const;
 
@@ -188,12 +255,37 @@ public:
     QList<CInterfaceMethod*> m_methods;
 
 private:
-    QString generateImmutablePropertiesListHelper(const int creatorSpacing, bool names, bool signatures) const;
-    QString generatePrivateConstructorPropertiesList(const int creatorSpacing) const;
-    QString generateMethodCallbackAndDeclaration(const CInterfaceMethod *method) const;
-    QString formatArguments(const CArgumentsFeature *argumentsClass, bool argName, bool hideOutputArguments = false, bool addType = true) const;
-    QString formatArgument(const CMethodArgument &arg, bool addName) const;
-    QString formatInvokeMethodArguments(const CArgumentsFeature *argumentsClass) const;
+    CInterfaceSignal *signalByName(const QString &name) const; // The notifier lookup of prepare()
+    void generateImmutablePropertiesListHelper(CCodeEmitter &out, const int creatorSpacing, bool names, bool signatures) const;
+    void generatePrivateConstructorPropertiesList(CCodeEmitter &out, const int creatorSpacing) const;
+    void generateImmutablePropertiesInserts(CCodeEmitter &out, const QString &mapName, bool staticKeys) const;
+    void generateMethodCallbackAndDeclaration(CCodeEmitter &out, const CInterfaceMethod *method) const;
+    bool hasRvalueSetter(const CInterfaceProperty *prop) const;
+    bool hasAtomicStorage(const CInterfaceProperty *prop) const;
+    bool hasSnapshotStorage(const CInterfaceProperty *prop) const;
+    QString storedValue(const CInterfaceProperty *prop) const;
+    QString storeValue(const CInterfaceProperty *prop, const QString &value) const;
+    static QString templateArgument(const QString &type);
+    bool isCoalescedProperty(const CInterfaceProperty *prop) const;
+    QString namesTable() const;
+    QString propertyNameKey(const CInterfaceProperty *prop) const;
+    void generateNamesTable(CCodeEmitter &out) const;
+    void generatePropertySetter(CCodeEmitter &out, const CInterfaceProperty *prop, bool rvalue) const;
+    void generatePropertyChangesCommit(CCodeEmitter &out) const;
+    void generateAsyncMethodImplementation(CCodeEmitter &out, const CInterfaceMethod *method) const;
+    void generateMethodStatisticsRecorder(CCodeEmitter &out) const;
+    void generateMethodStatisticsGetter(CCodeEmitter &out) const;
+    void generateTraceBegin(CCodeEmitter &out, const CInterfaceMethod *method) const;
+    void generateTraceEnd(CCodeEmitter &out, const CInterfaceMethod *method) const;
+    void generateSignalEmission(CCodeEmitter &out, const CInterfaceSignal *sig) const;
+    void writeArguments(CCodeEmitter &out, const CArgumentsFeature *argumentsClass, bool argName, bool hideOutputArguments = false, bool addType = true) const;
+    void writeInvokeMethodArguments(CCodeEmitter &out, const CArgumentsFeature *argumentsClass) const;
+
+    QHash<QString, CInterfaceSignal*> m_signalsByName;
+    CModelArena m_arena;
+    CStringPool m_stringPool;
+    QStringList m_referencedTypes;
+    QString m_specFileName;
 
     QString m_adapteeParentMember;
     InterfaceType m_type;
@@ -202,10 +294,13 @@ private:
     QString m_nodeName;
     QString m_name;
     QString m_fullName;
+    QString m_dbusName;
     SpecFormat m_specFormat = SpecFormat::Invalid;
     int m_mutablePropertiesCount;
     int m_immutablePropertiesCount;
+    int m_coalescedPropertiesCount;
     bool m_emitPropertiesChangedSignal;
+    uint m_options;
 
 };
 
@@ -0,0 +1,49 @@
+#include "CModelArena.hpp"
+
+static const size_t s_blockSize = 16 * 1024;
+
+CModelArena::CModelArena() :
+    m_blockUsed(0)
+{
+}
+
+CModelArena::~CModelArena()
+{
+    clear();
+}
+
+void CModelArena::clear()
+{
+    // Reverse order, as if the objects were on the stack.
+    for (int i = m_objects.count() - 1; i >= 0; --i) {
+        m_objects.at(i).destructor(m_objects.at(i).object);
+    }
+    m_objects.clear();
+
+    foreach (char *block, m_blocks) {
+        delete[] block;
+    }
+    m_blocks.clear();
+    m_blockUsed = 0;
+}
+
+void *CModelArena::allocate(size_t size, size_t alignment)
+{
+    size_t offset = (m_blockUsed + alignment - 1) & ~(alignment - 1);
+
+    if (m_blocks.isEmpty() || (offset + size > s_blockSize)) {
+        // new[] memory is aligned for any fundamental type; oversized objects get a block of their own.
+        m_blocks.append(new char[qMax(size, s_blockSize)]);
+        offset = 0;
+    }
+
+    m_blockUsed = offset + size;
+
+    return m_blocks.last() + offset;
+}
+
+void CModelArena::registerObject(void *object, Destructor destructor)
+{
+    const Object entry = { object, destructor };
+    m_objects.append(entry);
+}
@@ -0,0 +1,60 @@
+#ifndef CMODELARENA_HPP
+#define CMODELARENA_HPP
+
+#include <QList>
+#include <QVector>
+
+#include <new>
+
+// Allocates the objects of an interface model from a few large blocks.
+// Objects are never freed one by one: clear() (or the destructor) destroys all of them at once.
+class CModelArena
+{
+public:
+    CModelArena();
+    ~CModelArena();
+
+    template<typename T>
+    T *create()
+    {
+        T *object = new (allocate(sizeof(T), alignof(T))) T();
+        registerObject(object, &destroy<T>);
+        return object;
+    }
+
+    template<typename T, typename Argument>
+    T *create(const Argument &argument)
+    {
+        T *object = new (allocate(sizeof(T), alignof(T))) T(argument);
+        registerObject(object, &destroy<T>);
+        return object;
+    }
+
+    void clear();
+
+private:
+    Q_DISABLE_COPY(CModelArena)
+
+    typedef void (*Destructor)(void *object);
+
+    struct Object {
+        void *object;
+        Destructor destructor;
+    };
+
+    template<typename T>
+    static void destroy(void *object)
+    {
+        static_cast<T*>(object)->~T();
+    }
+
+    void *allocate(size_t size, size_t alignment);
+    void registerObject(void *object, Destructor destructor);
+
+    QList<char*> m_blocks;
+    QVector<Object> m_objects;
+    size_t m_blockUsed;
+
+};
+
+#endif // CMODELARENA_HPP
@@ -0,0 +1,143 @@
+#include "CServiceGenerator.hpp"
+
+#include <QIODevice>
+
+#include "CCodeEmitter.hpp"
+#include "CInterfaceGenerator.hpp"
+#include "CSpecReader.hpp"
+#include "CTypeRegistry.hpp"
+
+static bool readSpec(const QByteArray &specContent, CInterfaceGenerator *generator, QString *errorString,
+                     CTypeRegistry *typeRegistry = 0)
+{
+    CSpecReader reader;
+
+    if (!reader.read(specContent, generator, typeRegistry)) {
+        if (errorString) {
+            *errorString = reader.errorString();
+        }
+        return false;
+    }
+
+    generator->prepare();
+
+    return true;
+}
+
+CServiceGenerator::CServiceGenerator(uint options) :
+    m_options(options)
+{
+}
+
+CGeneratedCode CServiceGenerator::generate(const QByteArray &specContent, QString *errorString) const
+{
+    CInterfaceGenerator generator;
+    generator.setOptions(m_options);
+
+    // The type definitions are collected by the same parse.
+    CTypeRegistry typeDefinitions;
+
+    if (!readSpec(specContent, &generator, errorString, &typeDefinitions)) {
+        // Invalid, but the definitions still count for the other specs.
+        CGeneratedCode result;
+        result.typeDefinitions = typeDefinitions;
+        return result;
+    }
+
+    CGeneratedCode result = generate(generator);
+    result.typeDefinitions = typeDefinitions;
+
+    return result;
+}
+
+CGeneratedCode CServiceGenerator::generate(QIODevice *specDevice, QString *errorString) const
+{
+    if (!specDevice->isReadable()) {
+        if (errorString) {
+            *errorString = QLatin1String("The spec device is not readable");
+        }
+        return CGeneratedCode();
+    }
+
+    return generate(specDevice->readAll(), errorString);
+}
+
+bool CServiceGenerator::generate(const QByteArray &specContent,
+                                 QIODevice *publicHeader, QIODevice *internalHeader, QIODevice *implementation,
+                                 QString *errorString) const
+{
+    CInterfaceGenerator generator;
+    generator.setOptions(m_options);
+
+    if (!readSpec(specContent, &generator, errorString)) {
+        return false;
+    }
+
+    {
+        CCodeEmitter out(publicHeader);
+        generator.generateHeaderInterface(out);
+    }
+    {
+        CCodeEmitter out(internalHeader);
+        generator.generateHeaderAdaptee(out);
+    }
+    {
+        CCodeEmitter out(implementation);
+        generator.generateImplementations(out);
+    }
+
+    return true;
+}
+
+CGeneratedCode CServiceGenerator::generate(const CInterfaceGenerator &generator) const
+{
+    CGeneratedCode result;
+    result.className = generator.className();
+    result.referencedTypes = generator.referencedTypes();
+
+    {
+        CCodeEmitter out(&result.publicHeader);
+        generator.generateHeaderInterface(out);
+    }
+    {
+        CCodeEmitter out(&result.internalHeader);
+        generator.generateHeaderAdaptee(out);
+    }
+    {
+        CCodeEmitter out(&result.implementation);
+        generator.generateImplementations(out);
+    }
+
+    return result;
+}
+
+QList<CInterfaceGenerator*> CServiceGenerator::readTree(const QString &fileName, CTypeRegistry *typeRegistry,
+                                                        QStringList *treeFileNames, QString *errorString,
+                                                        QStringList *skippedInterfaces) const
+{
+    QList<CInterfaceGenerator*> generators;
+    CSpecReader reader;
+
+    if (!reader.readTree(fileName, &generators, typeRegistry)) {
+        if (errorString) {
+            *errorString = reader.errorString();
+        }
+        qDeleteAll(generators);
+        return QList<CInterfaceGenerator*>();
+    }
+
+    foreach (CInterfaceGenerator *generator, generators) {
+        generator->setOptions(m_options);
+        generator->prepare();
+    }
+
+    if (treeFileNames) {
+        *treeFileNames = reader.treeFileNames();
+    }
+
+    if (skippedInterfaces) {
+        *skippedInterfaces = reader.skippedInterfaces();
+    }
+
+    return generators;
+}
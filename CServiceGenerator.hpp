@@ -0,0 +1,49 @@
+#ifndef CSERVICEGENERATOR_HPP
+#define CSERVICEGENERATOR_HPP
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+#include "CGeneratedCode.hpp"
+
+class CInterfaceGenerator;
+class CTypeRegistry;
+class QIODevice;
+
+// In-memory entry point of the generator library: spec content in, generated sections out.
+// There is no shared state between calls, so one instance can be used from several threads at once.
+class CServiceGenerator
+{
+public:
+    explicit CServiceGenerator(uint options = 0); // CInterfaceGenerator::GenerationOption flags
+
+    uint options() const { return m_options; }
+
+    // Returns an invalid result (without a class name) on error; the type definitions read are still set.
+    CGeneratedCode generate(const QByteArray &specContent, QString *errorString = 0) const;
+    CGeneratedCode generate(QIODevice *specDevice, QString *errorString = 0) const;
+
+    // Streams the sections to the given devices instead of collecting them.
+    bool generate(const QByteArray &specContent,
+                  QIODevice *publicHeader, QIODevice *internalHeader, QIODevice *implementation,
+                  QString *errorString = 0) const;
+
+    // Generates the code of a prepared model. The model is only read, so the models of a tree
+    // can be generated in parallel.
+    CGeneratedCode generate(const CInterfaceGenerator &generator) const;
+
+    // Whole-tree mode: reads the spec and the specs it includes (xi:include) once, and returns a prepared
+    // model for every interface found, owned by the caller. Returns an empty list on error.
+    // The interfaces that could not be read are described in skippedInterfaces.
+    QList<CInterfaceGenerator*> readTree(const QString &fileName, CTypeRegistry *typeRegistry = 0,
+                                         QStringList *treeFileNames = 0, QString *errorString = 0,
+                                         QStringList *skippedInterfaces = 0) const;
+
+private:
+    uint m_options;
+
+};
+
+#endif // CSERVICEGENERATOR_HPP
@@ -0,0 +1,214 @@
+#include "CSignatureParser.hpp"
+
+#include <algorithm>
+
+// D-Bus signature -> Qt type. Must be sorted by the signature (ASCII order), the lookup is a binary search.
+static const DBusTypeMapping s_typeMappings[] = {
+    { "aav",   "Tp::VariantListList", 0,       DBusTypeMapping::NoTypeFlags },
+    { "ag",    "Tp::SignatureList",   0,       DBusTypeMapping::NoTypeFlags },
+    { "ao",    "Tp::ObjectPathList",  0,       DBusTypeMapping::NoTypeFlags },
+    { "as",    "QStringList",         0,       DBusTypeMapping::NoTypeFlags },
+    { "au",    "Tp::UIntList",        0,       DBusTypeMapping::NoTypeFlags },
+    { "av",    "QVariantList",        0,       DBusTypeMapping::NoTypeFlags },
+    { "ay",    "QByteArray",          0,       DBusTypeMapping::NoTypeFlags },
+    { "a{sv}", "QVariantMap",         0,       DBusTypeMapping::NoTypeFlags },
+    { "b",     "bool",                "false", DBusTypeMapping::Pod },
+    { "d",     "double",              "0",     DBusTypeMapping::Pod },
+    { "g",     "QDBusSignature",      0,       DBusTypeMapping::NoTypeFlags },
+    { "i",     "int",                 "0",     DBusTypeMapping::Pod },
+    { "n",     "short",               "0",     DBusTypeMapping::Pod },
+    { "o",     "QDBusObjectPath",     0,       DBusTypeMapping::NoTypeFlags },
+    { "q",     "ushort",              "0",     DBusTypeMapping::Pod },
+    { "s",     "QString",             0,       DBusTypeMapping::NoTypeFlags },
+    { "t",     "qulonglong",          "0",     DBusTypeMapping::Pod },
+    { "u",     "uint",                "0",     DBusTypeMapping::Pod },
+    { "v",     "QDBusVariant",        0,       DBusTypeMapping::NotComparable },
+    { "x",     "qlonglong",           "0",     DBusTypeMapping::Pod },
+    { "y",     "uchar",               "0",     DBusTypeMapping::Pod },
+};
+
+const DBusTypeMapping *CSignatureParser::findMapping(const QString &signature)
+{
+    const DBusTypeMapping *begin = s_typeMappings;
+    const DBusTypeMapping *end = s_typeMappings + sizeof(s_typeMappings) / sizeof(s_typeMappings[0]);
+
+    const DBusTypeMapping *mapping = std::lower_bound(begin, end, signature,
+                                                      [](const DBusTypeMapping &entry, const QString &signature) {
+        return signature.compare(QLatin1String(entry.signature)) > 0;
+    });
+
+    if ((mapping == end) || (signature != QLatin1String(mapping->signature))) {
+        return 0;
+    }
+
+    return mapping;
+}
+
+QString CSignatureParser::errorString(Error error)
+{
+    switch (error) {
+    case NoError:
+        return QString();
+    case InvalidSignature:
+        return QLatin1String("Invalid or unsupported D-Bus signature");
+    case UnnamedStruct:
+        return QLatin1String("Struct type without tp:type name");
+    }
+
+    return QString();
+}
+
+QString CSignatureParser::qtType(const QString &signature, Error *error)
+{
+    if (!m_mappedTypes.contains(signature)) {
+        MappedType mappedType;
+        mappedType.error = NoError;
+
+        CDBusTypeNode node;
+        if (parse(signature, &node, &mappedType.error)) {
+            mappedType.type = mapNode(node, /* nested */ false, &mappedType.error);
+        }
+
+        m_mappedTypes.insert(signature, mappedType);
+    }
+
+    const MappedType &mappedType = m_mappedTypes[signature];
+    *error = mappedType.error;
+
+    return mappedType.type;
+}
+
+bool CSignatureParser::parse(const QString &signature, CDBusTypeNode *node, Error *error) const
+{
+    int position = 0;
+
+    // The signature must contain exactly one complete type.
+    if (!parseSingleType(signature, &position, node) || (position != signature.size())) {
+        *error = InvalidSignature;
+        return false;
+    }
+
+    return true;
+}
+
+bool CSignatureParser::parseSingleType(const QString &signature, int *position, CDBusTypeNode *node) const
+{
+    if (*position >= signature.size()) {
+        return false;
+    }
+
+    const int start = *position;
+    const char typeCode = signature.at(*position).toLatin1();
+    ++*position;
+
+    switch (typeCode) {
+    case 'a':
+        if ((*position < signature.size()) && (signature.at(*position) == QLatin1Char('{'))) {
+            ++*position;
+            node->kind = CDBusTypeNode::Dict;
+
+            CDBusTypeNode key;
+            CDBusTypeNode value;
+
+            // Dict keys must be basic types.
+            if (!parseSingleType(signature, position, &key) || (key.kind != CDBusTypeNode::Basic)) {
+                return false;
+            }
+
+            if (!parseSingleType(signature, position, &value)) {
+                return false;
+            }
+
+            if ((*position >= signature.size()) || (signature.at(*position) != QLatin1Char('}'))) {
+                return false;
+            }
+            ++*position;
+
+            node->children << key << value;
+        } else {
+            node->kind = CDBusTypeNode::Array;
+
+            CDBusTypeNode element;
+            if (!parseSingleType(signature, position, &element)) {
+                return false;
+            }
+
+            node->children << element;
+        }
+        break;
+    case '(':
+        node->kind = CDBusTypeNode::Struct;
+
+        while ((*position < signature.size()) && (signature.at(*position) != QLatin1Char(')'))) {
+            CDBusTypeNode member;
+            if (!parseSingleType(signature, position, &member)) {
+                return false;
+            }
+
+            node->children << member;
+        }
+
+        if ((*position >= signature.size()) || node->children.isEmpty()) {
+            return false;
+        }
+        ++*position;
+        break;
+    case 'v':
+        node->kind = CDBusTypeNode::Variant;
+        break;
+    default:
+        if (!findMapping(QString(QLatin1Char(typeCode)))) {
+            return false;
+        }
+        node->kind = CDBusTypeNode::Basic;
+        break;
+    }
+
+    node->signature = signature.mid(start, *position - start);
+
+    return true;
+}
+
+QString CSignatureParser::mapNode(const CDBusTypeNode &node, bool nested, Error *error) const
+{
+    // Variants inside of containers are QVariant, as for the QVariantList and QVariantMap.
+    if (node.kind == CDBusTypeNode::Variant) {
+        return nested ? QLatin1String("QVariant") : QLatin1String("QDBusVariant");
+    }
+
+    const DBusTypeMapping *mapping = findMapping(node.signature);
+    if (mapping) {
+        return QLatin1String(mapping->type);
+    }
+
+    QString result;
+
+    switch (node.kind) {
+    case CDBusTypeNode::Array:
+        result = QLatin1String("QList<") + mapNode(node.children.at(0), /* nested */ true, error);
+        break;
+    case CDBusTypeNode::Dict:
+        result = QLatin1String("QMap<") + mapNode(node.children.at(0), /* nested */ true, error)
+                + QLatin1String(", ") + mapNode(node.children.at(1), /* nested */ true, error);
+        break;
+    case CDBusTypeNode::Struct:
+        // There is no way to know the name of the struct type from the signature.
+        *error = UnnamedStruct;
+        return QString();
+    default:
+        *error = InvalidSignature;
+        return QString();
+    }
+
+    if (*error != NoError) {
+        return QString();
+    }
+
+    // Keep the code C++98 compatible: no ">>" in the nested templates.
+    if (result.endsWith(QLatin1Char('>'))) {
+        result += QLatin1Char(' ');
+    }
+    result += QLatin1Char('>');
+
+    return result;
+}
@@ -0,0 +1,71 @@
+#ifndef CSIGNATUREPARSER_HPP
+#define CSIGNATUREPARSER_HPP
+
+#include <QHash>
+#include <QList>
+#include <QString>
+
+struct DBusTypeMapping
+{
+    enum TypeFlag {
+        NoTypeFlags = 0,
+        Pod = 1 << 0,
+        NotComparable = 1 << 1 // The type has no operator==()
+    };
+
+    const char *signature;
+    const char *type;
+    const char *defaultValue;
+    uint flags;
+};
+
+class CDBusTypeNode
+{
+public:
+    enum Kind {
+        Basic,
+        Variant,
+        Array,
+        Dict,
+        Struct
+    };
+
+    CDBusTypeNode() : kind(Basic) { }
+
+    Kind kind;
+    QString signature;
+    QList<CDBusTypeNode> children;
+};
+
+class CSignatureParser
+{
+public:
+    enum Error {
+        NoError,
+        InvalidSignature,
+        UnnamedStruct
+    };
+
+    // Maps a complete D-Bus type signature to a Qt type without the help of tp:type.
+    // The results are memoized, so every distinct signature is parsed only once per parser.
+    QString qtType(const QString &signature, Error *error);
+
+    bool parse(const QString &signature, CDBusTypeNode *node, Error *error) const;
+
+    static const DBusTypeMapping *findMapping(const QString &signature);
+    static QString errorString(Error error);
+
+private:
+    struct MappedType {
+        QString type;
+        Error error;
+    };
+
+    bool parseSingleType(const QString &signature, int *position, CDBusTypeNode *node) const;
+    QString mapNode(const CDBusTypeNode &node, bool nested, Error *error) const;
+
+    QHash<QString, MappedType> m_mappedTypes;
+
+};
+
+#endif // CSIGNATUREPARSER_HPP
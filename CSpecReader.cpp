@@ -0,0 +1,343 @@
+#include "CSpecReader.hpp"
+
+#include "CInterfaceGenerator.hpp"
+#include "CTypeRegistry.hpp"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+static const bool skipDeprecatedEntries = true;
+
+static const QLatin1String s_nodeElement = QLatin1String("node");
+static const QLatin1String s_interfaceElement = QLatin1String("interface");
+static const QLatin1String s_includeElement = QLatin1String("xi:include");
+static const QLatin1String s_annotationElement = QLatin1String("annotation");
+static const QLatin1String s_propertyElement = QLatin1String("property");
+static const QLatin1String s_methodElement = QLatin1String("method");
+static const QLatin1String s_signalElement = QLatin1String("signal");
+static const QLatin1String s_argElement = QLatin1String("arg");
+static const QLatin1String s_docStringElement = QLatin1String("tp:docstring");
+static const QLatin1String s_deprecatedElement = QLatin1String("tp:deprecated");
+
+static const QLatin1String s_nameAttribute = QLatin1String("name");
+static const QLatin1String s_typeAttribute = QLatin1String("type");
+static const QLatin1String s_tpTypeAttribute = QLatin1String("tp:type");
+
+CSpecReader::CSpecReader() :
+    m_generator(0),
+    m_typeRegistry(0)
+{
+    // Spec files use the "tp:" prefix for their own elements; compare qualified names instead of resolving it.
+    m_reader.setNamespaceProcessing(false);
+}
+
+bool CSpecReader::read(const QByteArray &specContent, CInterfaceGenerator *generator, CTypeRegistry *typeRegistry)
+{
+    m_reader.clear();
+    m_reader.addData(specContent);
+    m_generator = generator;
+    m_typeRegistry = typeRegistry;
+    m_fileName.clear();
+    m_errorString.clear();
+
+    bool interfaceFound = false;
+
+    if (m_reader.readNextStartElement()) {
+        const QString node = attribute(s_nameAttribute);
+
+        while (m_reader.readNextStartElement()) {
+            if (!interfaceFound && (m_reader.qualifiedName() == s_interfaceElement)) {
+                if (!readInterface(node)) {
+                    return false;
+                }
+                interfaceFound = true;
+            } else if (m_typeRegistry && CTypeRegistry::isTypeDefinition(m_reader.qualifiedName())) {
+                m_typeRegistry->readDefinition(&m_reader, m_fileName);
+            } else {
+                m_reader.skipCurrentElement();
+            }
+        }
+    }
+
+    if (m_reader.hasError()) {
+        m_errorString = QString(QLatin1String("XML error at line %1: %2")).arg(m_reader.lineNumber()).arg(m_reader.errorString());
+        return false;
+    }
+
+    if (!interfaceFound) {
+        m_errorString = QLatin1String("There is no interface element");
+        return false;
+    }
+
+    // Type errors are not fatal for the reading, but the generated code would be wrong.
+    return m_errorString.isEmpty();
+}
+
+bool CSpecReader::readTree(const QString &fileName, QList<CInterfaceGenerator*> *generators, CTypeRegistry *typeRegistry)
+{
+    m_typeRegistry = typeRegistry;
+    m_errorString.clear();
+    m_treeFileNames.clear();
+    m_skippedInterfaces.clear();
+
+    // The includes are read after the including file, so the one XML reader is enough.
+    QStringList pendingFiles = QStringList() << QDir::cleanPath(fileName);
+
+    while (!pendingFiles.isEmpty()) {
+        const QString specFileName = pendingFiles.takeFirst();
+
+        if (m_treeFileNames.contains(specFileName)) {
+            continue;
+        }
+        m_treeFileNames.append(specFileName);
+
+        if (!readTreeFile(specFileName, generators, &pendingFiles)) {
+            return false;
+        }
+    }
+
+    m_typeRegistry = 0;
+
+    return true;
+}
+
+bool CSpecReader::readTreeFile(const QString &fileName, QList<CInterfaceGenerator*> *generators, QStringList *pendingFiles)
+{
+    QFile specFile(fileName);
+    if (!specFile.open(QIODevice::ReadOnly)) {
+        m_errorString = QString(QLatin1String("Could not open file %1")).arg(fileName);
+        return false;
+    }
+
+    m_reader.clear();
+    m_reader.addData(specFile.readAll());
+    m_fileName = fileName;
+
+    const QDir specDir = QFileInfo(fileName).dir();
+    QString node;
+    QList<CInterfaceGenerator*> nodeGenerators;
+
+    while (!m_reader.atEnd()) {
+        m_reader.readNext();
+
+        if (!m_reader.isStartElement()) {
+            continue;
+        }
+
+        const QStringRef elementName = m_reader.qualifiedName();
+
+        if (elementName == s_nodeElement) {
+            node = attribute(s_nameAttribute);
+            nodeGenerators.clear();
+        } else if (elementName == s_includeElement) {
+            pendingFiles->append(QDir::cleanPath(specDir.filePath(attribute(QLatin1String("href")))));
+            m_reader.skipCurrentElement();
+        } else if (elementName == s_interfaceElement) {
+            CInterfaceGenerator *generator = new CInterfaceGenerator();
+            generator->setSpecFileName(fileName);
+            m_generator = generator;
+
+            const bool interfaceRead = readInterface(node);
+
+            if (!interfaceRead || !m_errorString.isEmpty()) {
+                if (!interfaceRead) {
+                    m_reader.skipCurrentElement();
+                }
+                m_skippedInterfaces.append(QString(QLatin1String("%1 in %2: %3")).arg(generator->fullName(), fileName, m_errorString));
+                m_errorString.clear();
+                delete generator;
+                continue;
+            }
+
+            generators->append(generator);
+            nodeGenerators.append(generator);
+
+            // The class name is made of the node name, so the interfaces of a node with several
+            // ones are named after the interface instead.
+            if (nodeGenerators.count() > 1) {
+                foreach (CInterfaceGenerator *nodeGenerator, nodeGenerators) {
+                    nodeGenerator->setNodeName(nodeGenerator->interfaceName());
+                }
+            }
+        } else if (m_typeRegistry && CTypeRegistry::isTypeDefinition(elementName)) {
+            m_typeRegistry->readDefinition(&m_reader, fileName);
+        }
+    }
+
+    m_generator = 0;
+
+    if (m_reader.hasError()) {
+        m_errorString = QString(QLatin1String("XML error in %1 at line %2: %3")).arg(fileName).arg(m_reader.lineNumber()).arg(m_reader.errorString());
+        return false;
+    }
+
+    return true;
+}
+
+bool CSpecReader::readInterface(const QString &node)
+{
+    m_generator->setFullName(attribute(s_nameAttribute));
+
+    if (!m_generator->isValid()) {
+        m_errorString = QLatin1String("File doesn't contain telepathy spec in known format (Error 1)");
+        return false;
+    }
+
+    m_generator->setNode(node);
+
+    while (m_reader.readNextStartElement()) {
+        const QStringRef elementName = m_reader.qualifiedName();
+
+        if (elementName == s_propertyElement) {
+            readProperty();
+        } else if (elementName == s_methodElement) {
+            readMethod();
+        } else if (elementName == s_signalElement) {
+            readSignal();
+        } else if (m_typeRegistry && CTypeRegistry::isTypeDefinition(elementName)) {
+            m_typeRegistry->readDefinition(&m_reader, m_fileName);
+        } else {
+            if (elementName == s_annotationElement) {
+                if (attribute(s_nameAttribute) == QLatin1String("org.freedesktop.DBus.Property.EmitsChangedSignal")) {
+                    m_generator->setEmitPropertiesChangedSignal(true);
+                }
+            }
+            m_reader.skipCurrentElement();
+        }
+    }
+
+    return true;
+}
+
+void CSpecReader::readProperty()
+{
+    m_entryErrorString.clear();
+
+    CInterfaceProperty *property = m_generator->createProperty();
+    property->setName(attribute(s_nameAttribute));
+    readType(property);
+    property->internStrings(m_generator->stringPool());
+    property->setImmutable(attribute(QLatin1String("tp:immutable")) == QLatin1String("yes"));
+
+    bool deprecated = false;
+
+    while (m_reader.readNextStartElement()) {
+        if (m_reader.qualifiedName() == s_docStringElement) {
+            readPropertyDocString(property);
+        } else {
+            if (m_reader.qualifiedName() == s_deprecatedElement) {
+                deprecated = true;
+            }
+            m_reader.skipCurrentElement();
+        }
+    }
+
+    // Skipped entries stay in the generator arena until the model is cleared.
+    if (skipDeprecatedEntries && deprecated) {
+        return;
+    }
+
+    commitEntryError();
+    m_generator->m_properties.append(property);
+}
+
+void CSpecReader::readPropertyDocString(CInterfaceProperty *property)
+{
+    // The only docstring content we are interested in. Check the text of direct children (paragraphs).
+    while (m_reader.readNextStartElement()) {
+        if (m_reader.readElementText(QXmlStreamReader::IncludeChildElements) == QLatin1String("This property cannot change during the lifetime of the channel.")) {
+            property->setUnchangeable(true);
+        }
+    }
+}
+
+void CSpecReader::readMethod()
+{
+    m_entryErrorString.clear();
+
+    CInterfaceMethod *method = m_generator->createMethod(attribute(s_nameAttribute));
+    method->internName(m_generator->stringPool());
+
+    if (readArgumentsAndCheckDeprecation(method, /* forceInputDirection */ false) && skipDeprecatedEntries) {
+        return;
+    }
+
+    commitEntryError();
+    m_generator->m_methods.append(method);
+}
+
+void CSpecReader::readSignal()
+{
+    m_entryErrorString.clear();
+
+    CInterfaceSignal *signal = m_generator->createSignal(attribute(s_nameAttribute));
+    signal->internName(m_generator->stringPool());
+
+    if (readArgumentsAndCheckDeprecation(signal, /* forceInputDirection */ true) && skipDeprecatedEntries) {
+        return;
+    }
+
+    commitEntryError();
+    m_generator->m_signals.append(signal);
+}
+
+bool CSpecReader::readArgumentsAndCheckDeprecation(CArgumentsFeature *argumentsClass, bool forceInputDirection)
+{
+    bool deprecated = false;
+
+    while (m_reader.readNextStartElement()) {
+        const QStringRef elementName = m_reader.qualifiedName();
+
+        if (elementName == s_argElement) {
+            CMethodArgument arg;
+            arg.setName(attribute(s_nameAttribute));
+            readType(&arg);
+
+            if (forceInputDirection) {
+                arg.setDirection(QLatin1String("in"));
+            } else {
+                arg.setDirection(attribute(QLatin1String("direction")));
+            }
+            arg.internStrings(m_generator->stringPool());
+
+            argumentsClass->arguments.append(arg);
+        } else if (elementName == s_deprecatedElement) {
+            deprecated = true;
+        }
+
+        m_reader.skipCurrentElement();
+    }
+
+    return deprecated;
+}
+
+void CSpecReader::readType(CTypeFeature *feature)
+{
+    const QString type = attribute(s_typeAttribute);
+    const QString tpType = attribute(s_tpTypeAttribute);
+    feature->setTypeFromStr(type, tpType, &m_signatureParser);
+
+    if (!tpType.isEmpty()) {
+        m_generator->addReferencedType(CTypeRegistry::baseTypeName(tpType));
+    }
+
+    // Kept until the end of the entry: a deprecated entry is skipped, and its type does not matter.
+    if ((feature->typeError() != CSignatureParser::NoError) && m_entryErrorString.isEmpty()) {
+        m_entryErrorString = QString(QLatin1String("Can't map type \"%1\" of %2 at line %3: %4"))
+                .arg(type, feature->nameAsIs(), QString::number(m_reader.lineNumber()), CSignatureParser::errorString(feature->typeError()));
+    }
+}
+
+void CSpecReader::commitEntryError()
+{
+    if (m_errorString.isEmpty()) {
+        m_errorString = m_entryErrorString;
+    }
+    m_entryErrorString.clear();
+}
+
+QString CSpecReader::attribute(const QLatin1String &name) const
+{
+    return m_reader.attributes().value(name).toString();
+}
@@ -0,0 +1,62 @@
+#ifndef CSPECREADER_HPP
+#define CSPECREADER_HPP
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QXmlStreamReader>
+
+#include "CSignatureParser.hpp"
+
+class CInterfaceGenerator;
+class CInterfaceProperty;
+class CArgumentsFeature;
+class CTypeFeature;
+class CTypeRegistry;
+
+// Single-pass reader of the Telepathy spec XML.
+// Fills the generator model directly and skips docstrings without building any tree for them.
+class CSpecReader
+{
+public:
+    CSpecReader();
+
+    // The type definitions of the spec (outside of the interface too) go to the registry, if given.
+    bool read(const QByteArray &specContent, CInterfaceGenerator *generator, CTypeRegistry *typeRegistry = 0);
+
+    QString errorString() const { return m_errorString; }
+
+    // Whole-tree mode: reads every interface of the spec file and of the specs it includes (xi:include),
+    // each into a new generator owned by the caller. The type definitions met on the way go to the registry.
+    // Interfaces that can not be generated are skipped and listed in skippedInterfaces().
+    bool readTree(const QString &fileName, QList<CInterfaceGenerator*> *generators, CTypeRegistry *typeRegistry = 0);
+
+    // Valid after readTree(): the spec file and all the included ones.
+    QStringList treeFileNames() const { return m_treeFileNames; }
+    QStringList skippedInterfaces() const { return m_skippedInterfaces; } // "<interface> in <file>: <error>"
+
+private:
+    bool readTreeFile(const QString &fileName, QList<CInterfaceGenerator*> *generators, QStringList *pendingFiles);
+    bool readInterface(const QString &node);
+    void readProperty();
+    void readPropertyDocString(CInterfaceProperty *property);
+    void readMethod();
+    void readSignal();
+    bool readArgumentsAndCheckDeprecation(CArgumentsFeature *argumentsClass, bool forceInputDirection);
+    void readType(CTypeFeature *feature);
+    void commitEntryError();
+    QString attribute(const QLatin1String &name) const;
+
+    QXmlStreamReader m_reader;
+    CSignatureParser m_signatureParser;
+    CInterfaceGenerator *m_generator;
+    CTypeRegistry *m_typeRegistry;
+    QString m_fileName;
+    QString m_errorString;
+    QString m_entryErrorString; // Type error of the property, method or signal being read
+    QStringList m_treeFileNames;
+    QStringList m_skippedInterfaces;
+
+};
+
+#endif // CSPECREADER_HPP
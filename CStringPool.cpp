@@ -0,0 +1,14 @@
+#include "CStringPool.hpp"
+
+QString CStringPool::intern(const QString &string)
+{
+    QSet<QString>::const_iterator it = m_strings.constFind(string);
+
+    if (it != m_strings.constEnd()) {
+        return *it;
+    }
+
+    m_strings.insert(string);
+
+    return string;
+}
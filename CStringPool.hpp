@@ -0,0 +1,20 @@
+#ifndef CSTRINGPOOL_HPP
+#define CSTRINGPOOL_HPP
+
+#include <QSet>
+#include <QString>
+
+// Shares one QString instance between all equal strings of a model, e.g. the types and argument names.
+class CStringPool
+{
+public:
+    QString intern(const QString &string);
+
+    void clear() { m_strings.clear(); }
+
+private:
+    QSet<QString> m_strings;
+
+};
+
+#endif // CSTRINGPOOL_HPP
@@ -0,0 +1,182 @@
+#include "CTypeRegistry.hpp"
+
+#include <QDataStream>
+#include <QFile>
+#include <QSet>
+#include <QXmlStreamReader>
+
+static const QLatin1String s_typeDefinitionElements[] = {
+    QLatin1String("tp:simple-type"),
+    QLatin1String("tp:enum"),
+    QLatin1String("tp:flags"),
+    QLatin1String("tp:mapping"),
+    QLatin1String("tp:struct"),
+    QLatin1String("tp:external-type"),
+};
+
+bool CTypeRegistry::readFile(const QString &fileName, QString *errorString)
+{
+    QFile specFile(fileName);
+    if (!specFile.open(QIODevice::ReadOnly)) {
+        if (errorString) {
+            *errorString = QString(QLatin1String("Could not open file %1")).arg(fileName);
+        }
+        return false;
+    }
+
+    return read(specFile.readAll(), fileName, errorString);
+}
+
+bool CTypeRegistry::read(const QByteArray &specContent, const QString &fileName, QString *errorString)
+{
+    QXmlStreamReader reader(specContent);
+    reader.setNamespaceProcessing(false);
+
+    while (!reader.atEnd()) {
+        reader.readNext();
+
+        if (reader.isStartElement() && isTypeDefinition(reader.qualifiedName())) {
+            readDefinition(&reader, fileName);
+        }
+    }
+
+    if (reader.hasError()) {
+        if (errorString) {
+            *errorString = QString(QLatin1String("XML error in %1 at line %2: %3")).arg(fileName).arg(reader.lineNumber()).arg(reader.errorString());
+        }
+        return false;
+    }
+
+    return true;
+}
+
+void CTypeRegistry::readDefinition(QXmlStreamReader *reader, const QString &fileName)
+{
+    const QString typeName = reader->attributes().value(QLatin1String("name")).toString();
+
+    TypeDefinition definition;
+    definition.fileName = fileName;
+
+    // Members (tp:member, tp:field, etc) refer to other types with their tp:type attribute.
+    int depth = 1;
+
+    while ((depth > 0) && !reader->atEnd()) {
+        reader->readNext();
+
+        if (reader->isStartElement()) {
+            ++depth;
+
+            const QString memberType = baseTypeName(reader->attributes().value(QLatin1String("tp:type")).toString());
+            if (!memberType.isEmpty() && !definition.referencedTypes.contains(memberType)) {
+                definition.referencedTypes.append(memberType);
+            }
+        } else if (reader->isEndElement()) {
+            --depth;
+        }
+    }
+
+    if (!typeName.isEmpty()) {
+        m_types.insert(typeName, definition);
+    }
+}
+
+bool CTypeRegistry::isTypeDefinition(const QStringRef &elementName)
+{
+    for (uint i = 0; i < sizeof(s_typeDefinitionElements) / sizeof(s_typeDefinitionElements[0]); ++i) {
+        if (elementName == s_typeDefinitionElements[i]) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void CTypeRegistry::merge(const CTypeRegistry &other, const QString &fileName)
+{
+    QHash<QString, TypeDefinition>::const_iterator it = other.m_types.constBegin();
+
+    for ( ; it != other.m_types.constEnd(); ++it) {
+        TypeDefinition definition = it.value();
+        if (!fileName.isEmpty()) {
+            definition.fileName = fileName;
+        }
+        m_types.insert(it.key(), definition);
+    }
+}
+
+QString CTypeRegistry::definingFile(const QString &typeName) const
+{
+    return m_types.value(baseTypeName(typeName)).fileName;
+}
+
+QStringList CTypeRegistry::dependencies(const QStringList &typeNames) const
+{
+    QStringList result;
+    QSet<QString> visitedTypes;
+    QStringList pendingTypes = typeNames;
+
+    while (!pendingTypes.isEmpty()) {
+        const QString typeName = baseTypeName(pendingTypes.takeLast());
+
+        if (visitedTypes.contains(typeName)) {
+            continue;
+        }
+        visitedTypes.insert(typeName);
+
+        QHash<QString, TypeDefinition>::const_iterator it = m_types.constFind(typeName);
+        if (it == m_types.constEnd()) {
+            continue;
+        }
+
+        if (!result.contains(it->fileName)) {
+            result.append(it->fileName);
+        }
+
+        pendingTypes += it->referencedTypes;
+    }
+
+    result.sort();
+
+    return result;
+}
+
+QString CTypeRegistry::baseTypeName(const QString &typeName)
+{
+    QString result = typeName;
+
+    while (result.endsWith(QLatin1String("[]"))) {
+        result.chop(2);
+    }
+
+    return result;
+}
+
+QDataStream &operator<<(QDataStream &stream, const CTypeRegistry &registry)
+{
+    stream << quint32(registry.m_types.count());
+
+    QHash<QString, CTypeRegistry::TypeDefinition>::const_iterator it = registry.m_types.constBegin();
+
+    for ( ; it != registry.m_types.constEnd(); ++it) {
+        stream << it.key() << it->fileName << it->referencedTypes;
+    }
+
+    return stream;
+}
+
+QDataStream &operator>>(QDataStream &stream, CTypeRegistry &registry)
+{
+    registry.m_types.clear();
+
+    quint32 count = 0;
+    stream >> count;
+
+    for (quint32 i = 0; (i < count) && (stream.status() == QDataStream::Ok); ++i) {
+        QString typeName;
+        CTypeRegistry::TypeDefinition definition;
+        stream >> typeName >> definition.fileName >> definition.referencedTypes;
+        registry.m_types.insert(typeName, definition);
+    }
+
+    return stream;
+}
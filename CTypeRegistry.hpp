@@ -0,0 +1,55 @@
+#ifndef CTYPEREGISTRY_HPP
+#define CTYPEREGISTRY_HPP
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+class QDataStream;
+class QStringRef;
+class QXmlStreamReader;
+
+// Index of the tp:type definitions (tp:struct, tp:mapping, tp:enum, etc) found in spec files,
+// with the file each type is defined in and the types it is built of.
+// Used to know which spec files the code generated for an interface depends on.
+class CTypeRegistry
+{
+public:
+    bool readFile(const QString &fileName, QString *errorString = 0);
+    bool read(const QByteArray &specContent, const QString &fileName, QString *errorString = 0);
+
+    // Reads the definition the reader is at (see isTypeDefinition()), up to its end element.
+    void readDefinition(QXmlStreamReader *reader, const QString &fileName);
+    static bool isTypeDefinition(const QStringRef &elementName);
+
+    // Adds the definitions of the other registry. With a file name, they are taken as defined there,
+    // e.g. when the other registry was filled from a spec read from memory.
+    void merge(const CTypeRegistry &other, const QString &fileName = QString());
+
+    int count() const { return m_types.count(); }
+    bool contains(const QString &typeName) const { return m_types.contains(baseTypeName(typeName)); }
+    QString definingFile(const QString &typeName) const;
+
+    // Files defining the given types and, recursively, the types they are built of. Unknown types are ignored.
+    QStringList dependencies(const QStringList &typeNames) const;
+
+    // "Contact_Handle[]" -> "Contact_Handle"
+    static QString baseTypeName(const QString &typeName);
+
+private:
+    struct TypeDefinition {
+        QString fileName;
+        QStringList referencedTypes;
+    };
+
+    QHash<QString, TypeDefinition> m_types;
+
+    friend QDataStream &operator<<(QDataStream &stream, const CTypeRegistry &registry);
+    friend QDataStream &operator>>(QDataStream &stream, CTypeRegistry &registry);
+
+};
+
+QDataStream &operator<<(QDataStream &stream, const CTypeRegistry &registry);
+QDataStream &operator>>(QDataStream &stream, CTypeRegistry &registry);
+
+#endif // CTYPEREGISTRY_HPP
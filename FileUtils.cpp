@@ -0,0 +1,31 @@
+#include "FileUtils.hpp"
+
+#include <QDebug>
+#include <QFile>
+#include <QSaveFile>
+
+bool writeFileIfChanged(const QString &fileName, const QByteArray &content)
+{
+    QFile existingFile(fileName);
+    if (existingFile.open(QIODevice::ReadOnly)) {
+        if ((existingFile.size() == content.size()) && (existingFile.readAll() == content)) {
+            return true;
+        }
+        existingFile.close();
+    }
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCritical() << "Could not open file" << fileName << "for writing:" << file.errorString();
+        return false;
+    }
+
+    file.write(content);
+
+    if (!file.commit()) {
+        qCritical() << "Could not write file" << fileName << ":" << file.errorString();
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,11 @@
+#ifndef FILEUTILS_HPP
+#define FILEUTILS_HPP
+
+#include <QByteArray>
+#include <QString>
+
+// Replaces the file content only if it differs from the given one, so the file timestamp is kept
+// for the unchanged files. Returns false on I/O error.
+bool writeFileIfChanged(const QString &fileName, const QByteArray &content);
+
+#endif // FILEUTILS_HPP
@@ -0,0 +1,30 @@
+#-------------------------------------------------
+#
+# Command line generator, built on top of the generator library
+#
+#-------------------------------------------------
+
+QT = core concurrent network
+
+TARGET = telepathy-qt-generator
+
+TEMPLATE = app
+
+CONFIG += console
+
+DESTDIR = $$OUT_PWD/..
+
+INCLUDEPATH += ..
+
+LIBS += -L$$OUT_PWD/../lib -ltelepathy-qt-generator
+PRE_TARGETDEPS += $$OUT_PWD/../lib/libtelepathy-qt-generator.a
+
+SOURCES += ../main.cpp \
+    ../CGenerationCache.cpp \
+    ../CGeneratorServer.cpp \
+    ../FileUtils.cpp
+
+HEADERS += \
+    ../CGenerationCache.hpp \
+    ../CGeneratorServer.hpp \
+    ../FileUtils.hpp
@@ -0,0 +1,219 @@
+#include <QDir>
+#include <QFile>
+#include <QtTest>
+
+#include "CCodeEmitter.hpp"
+#include "CInterfaceGenerator.hpp"
+#include "CSpecReader.hpp"
+
+// Benchmarks of the generator stages: spec reading, prepare() and each generate*() call.
+//
+// Synthetic specs are generated in memory with the given number of properties, methods and signals.
+// Set TP_SPEC_DIR to a directory with the Telepathy spec files to benchmark the real specs as well.
+
+class GeneratorBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void parse_data() { addSpecRows(); }
+    void parse();
+
+    void prepare_data() { addSpecRows(); }
+    void prepare();
+
+    void generateHeaderInterface_data() { addSpecRows(); }
+    void generateHeaderInterface();
+
+    void generateHeaderAdaptee_data() { addSpecRows(); }
+    void generateHeaderAdaptee();
+
+    void generateImplementations_data() { addSpecRows(); }
+    void generateImplementations();
+
+private:
+    static void addSpecRows();
+    static QByteArray syntheticSpec(int count);
+    static bool readSpec(const QByteArray &spec, CInterfaceGenerator *generator);
+
+};
+
+void GeneratorBenchmark::addSpecRows()
+{
+    QTest::addColumn<QByteArray>("spec");
+
+    static const int syntheticSizes[] = { 10, 100, 1000, 5000 };
+
+    for (uint i = 0; i < sizeof(syntheticSizes) / sizeof(syntheticSizes[0]); ++i) {
+        const QByteArray rowName = "synthetic-" + QByteArray::number(syntheticSizes[i]);
+        QTest::newRow(rowName.constData()) << syntheticSpec(syntheticSizes[i]);
+    }
+
+    const QString specDirName = QString::fromLocal8Bit(qgetenv("TP_SPEC_DIR"));
+    if (specDirName.isEmpty()) {
+        return;
+    }
+
+    const QDir specDir(specDirName);
+    foreach (const QString &entry, specDir.entryList(QStringList() << QLatin1String("*.xml"), QDir::Files, QDir::Name)) {
+        QFile specFile(specDir.filePath(entry));
+        if (!specFile.open(QIODevice::ReadOnly)) {
+            continue;
+        }
+
+        const QByteArray spec = specFile.readAll();
+
+        // Skip the files without an interface (e.g. all.xml or generic-types.xml)
+        CInterfaceGenerator generator;
+        const bool isInterfaceSpec = readSpec(spec, &generator);
+        generator.clearModel();
+
+        if (isInterfaceSpec) {
+            QTest::newRow(entry.toLocal8Bit().constData()) << spec;
+        }
+    }
+}
+
+QByteArray GeneratorBenchmark::syntheticSpec(int count)
+{
+    static const char *const types[][2] = {
+        { "u", "" },
+        { "b", "" },
+        { "s", "" },
+        { "as", "" },
+        { "a{sv}", "" },
+        { "au", "Contact_Handle[]" },
+        { "a{ua{sv}}", "Contact_Attributes_Map" },
+        { "a(sasuu)", "Field_Spec[]" },
+    };
+    static const int typesCount = sizeof(types) / sizeof(types[0]);
+
+    static const QByteArray docString =
+            "<tp:docstring xmlns=\"http://www.w3.org/1999/xhtml\">\n"
+            "  <p>Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor incididunt\n"
+            "    ut labore et dolore magna aliqua. Ut enim ad minim veniam, quis nostrud exercitation.</p>\n"
+            "  <p>Duis aute irure dolor in reprehenderit in voluptate velit esse cillum dolore eu fugiat.</p>\n"
+            "</tp:docstring>\n";
+
+    QByteArray spec;
+    spec += "<?xml version=\"1.0\" ?>\n"
+            "<node name=\"/Connection_Interface_Synthetic\" xmlns:tp=\"http://telepathy.freedesktop.org/wiki/DbusSpec#extensions-v0\">\n"
+            "<interface name=\"org.freedesktop.Telepathy.Connection.Interface.Synthetic\">\n";
+    spec += docString;
+
+    for (int i = 0; i < count; ++i) {
+        const QByteArray index = QByteArray::number(i);
+        const char *const *type = types[i % typesCount];
+
+        spec += "<property name=\"Property" + index + "\" type=\"" + type[0] + "\" tp:type=\"" + type[1]
+                + "\" access=\"read\"" + ((i % 3) ? "" : " tp:immutable=\"yes\"") + ">\n";
+        spec += docString;
+        spec += "</property>\n";
+
+        spec += "<method name=\"Method" + index + "\">\n";
+        spec += "<arg name=\"Input\" direction=\"in\" type=\"" + QByteArray(type[0]) + "\" tp:type=\"" + type[1] + "\">" + docString + "</arg>\n";
+        spec += "<arg name=\"Flag\" direction=\"in\" type=\"b\"/>\n";
+        if (i % 2) {
+            spec += "<arg name=\"Output\" direction=\"out\" type=\"" + QByteArray(type[0]) + "\" tp:type=\"" + type[1] + "\"/>\n";
+        }
+        spec += docString;
+        spec += "</method>\n";
+
+        // Every second property gets a notifier
+        spec += "<signal name=\"" + ((i % 2) ? "Property" + index + "Changed" : "Signal" + index) + "\">\n";
+        spec += "<arg name=\"Value\" type=\"" + QByteArray(type[0]) + "\" tp:type=\"" + type[1] + "\"/>\n";
+        spec += docString;
+        spec += "</signal>\n";
+    }
+
+    spec += "</interface>\n"
+            "</node>\n";
+
+    return spec;
+}
+
+bool GeneratorBenchmark::readSpec(const QByteArray &spec, CInterfaceGenerator *generator)
+{
+    CSpecReader reader;
+    return reader.read(spec, generator);
+}
+
+void GeneratorBenchmark::parse()
+{
+    QFETCH(QByteArray, spec);
+
+    QBENCHMARK {
+        CInterfaceGenerator generator;
+        QVERIFY(readSpec(spec, &generator));
+        generator.clearModel();
+    }
+}
+
+void GeneratorBenchmark::prepare()
+{
+    QFETCH(QByteArray, spec);
+
+    CInterfaceGenerator generator;
+    QVERIFY(readSpec(spec, &generator));
+
+    QBENCHMARK {
+        generator.prepare();
+    }
+
+    generator.clearModel();
+}
+
+void GeneratorBenchmark::generateHeaderInterface()
+{
+    QFETCH(QByteArray, spec);
+
+    CInterfaceGenerator generator;
+    QVERIFY(readSpec(spec, &generator));
+    generator.prepare();
+
+    QBENCHMARK {
+        QByteArray output;
+        CCodeEmitter out(&output);
+        generator.generateHeaderInterface(out);
+    }
+
+    generator.clearModel();
+}
+
+void GeneratorBenchmark::generateHeaderAdaptee()
+{
+    QFETCH(QByteArray, spec);
+
+    CInterfaceGenerator generator;
+    QVERIFY(readSpec(spec, &generator));
+    generator.prepare();
+
+    QBENCHMARK {
+        QByteArray output;
+        CCodeEmitter out(&output);
+        generator.generateHeaderAdaptee(out);
+    }
+
+    generator.clearModel();
+}
+
+void GeneratorBenchmark::generateImplementations()
+{
+    QFETCH(QByteArray, spec);
+
+    CInterfaceGenerator generator;
+    QVERIFY(readSpec(spec, &generator));
+    generator.prepare();
+
+    QBENCHMARK {
+        QByteArray output;
+        CCodeEmitter out(&output);
+        generator.generateImplementations(out);
+    }
+
+    generator.clearModel();
+}
+
+QTEST_APPLESS_MAIN(GeneratorBenchmark)
+
+#include "GeneratorBenchmark.moc"
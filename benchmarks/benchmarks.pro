@@ -0,0 +1,17 @@
+#-------------------------------------------------
+#
+# Generator benchmarks (QTest QBENCHMARK based)
+#
+#-------------------------------------------------
+
+QT = core testlib
+
+TARGET = generator-benchmark
+
+TEMPLATE = app
+
+CONFIG += console
+
+include(../generator.pri)
+
+SOURCES += GeneratorBenchmark.cpp
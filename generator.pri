@@ -0,0 +1,25 @@
+# Sources of the generator library, shared by the library target and the benchmarks.
+
+INCLUDEPATH += $$PWD
+
+SOURCES += \
+    $$PWD/CCodeEmitter.cpp \
+    $$PWD/CGeneratedCode.cpp \
+    $$PWD/CInterfaceGenerator.cpp \
+    $$PWD/CModelArena.cpp \
+    $$PWD/CServiceGenerator.cpp \
+    $$PWD/CSignatureParser.cpp \
+    $$PWD/CSpecReader.cpp \
+    $$PWD/CStringPool.cpp \
+    $$PWD/CTypeRegistry.cpp
+
+HEADERS += \
+    $$PWD/CCodeEmitter.hpp \
+    $$PWD/CGeneratedCode.hpp \
+    $$PWD/CInterfaceGenerator.hpp \
+    $$PWD/CModelArena.hpp \
+    $$PWD/CServiceGenerator.hpp \
+    $$PWD/CSignatureParser.hpp \
+    $$PWD/CSpecReader.hpp \
+    $$PWD/CStringPool.hpp \
+    $$PWD/CTypeRegistry.hpp
@@ -0,0 +1,15 @@
+#-------------------------------------------------
+#
+# Generator library: spec reading and code generation, without any file or command line handling
+#
+#-------------------------------------------------
+
+QT = core
+
+TARGET = telepathy-qt-generator
+
+TEMPLATE = lib
+
+CONFIG += staticlib
+
+include(../generator.pri)
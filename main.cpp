@@ -1,148 +1,520 @@
 #include <QDebug>
 
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
 #include <QFile>
-#include <QDomDocument>
+#include <QHash>
+#include <QScopedPointer>
 #include <QStringList>
+#include <QThreadPool>
+#include <QtConcurrentMap>
 
+#include "CGeneratedCode.hpp"
+#include "CGenerationCache.hpp"
+#include "CGeneratorServer.hpp"
 #include "CInterfaceGenerator.hpp"
+#include "CServiceGenerator.hpp"
+#include "CTypeRegistry.hpp"
+#include "FileUtils.hpp"
 
-static const bool skipDeprecatedEntries = true;
-static const QLatin1String s_deprecatedElement = QLatin1String("tp:deprecated");
+// Called from the worker pool; CServiceGenerator keeps no state between the calls.
+class SpecProcessor
+{
+public:
+    typedef CGeneratedCode result_type;
+
+    SpecProcessor(const CGenerationCache *cache, uint generationOptions) :
+        m_cache(cache),
+        m_generator(generationOptions)
+    {
+    }
+
+    CGeneratedCode operator()(const QString &fileName) const
+    {
+        QFile xmlFile(fileName);
+        if (!xmlFile.open(QIODevice::ReadOnly)) {
+            qCritical() << "Could not open file" << fileName;
+            return CGeneratedCode();
+        }
+
+        const QByteArray specContent = xmlFile.readAll();
+        xmlFile.close();
+
+        QByteArray cacheKey;
+
+        if (m_cache) {
+            cacheKey = m_cache->key(specContent);
+
+            QByteArray cachedData;
+            if (m_cache->lookup(cacheKey, &cachedData)) {
+                const CGeneratedCode code = CGeneratedCode::deserialize(cachedData);
+                if (code.isValid()) {
+                    return code;
+                }
+            }
+        }
+
+        QString errorString;
+        const CGeneratedCode code = m_generator.generate(specContent, &errorString);
+
+        if (!code.isValid()) {
+            qCritical() << "Could not read spec" << fileName << ":" << errorString;
+            return code;
+        }
+
+        if (m_cache) {
+            m_cache->store(cacheKey, code.serialize());
+        }
+
+        return code;
+    }
+
+private:
+    const CGenerationCache *m_cache;
+    CServiceGenerator m_generator;
+
+};
+
+// Called from the worker pool on the models of a spec tree, which are only read.
+class InterfaceProcessor
+{
+public:
+    typedef CGeneratedCode result_type;
+
+    explicit InterfaceProcessor(uint generationOptions) :
+        m_generator(generationOptions)
+    {
+    }
+
+    CGeneratedCode operator()(const CInterfaceGenerator *generator) const
+    {
+        return m_generator.generate(*generator);
+    }
+
+private:
+    CServiceGenerator m_generator;
+
+};
+
+QStringList outputFileNames(const CGeneratedCode &code, const QString &outputDirectory)
+{
+    const QString baseName = outputDirectory + QLatin1Char('/') + code.className;
+
+    return QStringList() << baseName + QLatin1String(".h")
+                         << baseName + QLatin1String("-internal.h")
+                         << baseName + QLatin1String(".cpp");
+}
+
+bool writeCode(const CGeneratedCode &code, const QString &outputDirectory)
+{
+    const QStringList fileNames = outputFileNames(code, outputDirectory);
+
+    // Evaluate all of them, even if one fails.
+    bool success = writeFileIfChanged(fileNames.at(0), code.publicHeader);
+    success = writeFileIfChanged(fileNames.at(1), code.internalHeader) && success;
+    success = writeFileIfChanged(fileNames.at(2), code.implementation) && success;
 
-void processSpec(const QString &fileName)
+    return success;
+}
+
+QByteArray escapeDependency(const QString &fileName)
 {
-    QFile xmlFile(fileName);
-    if (!xmlFile.open(QIODevice::ReadOnly)) {
-        qCritical() << "Could not open file" << fileName;
-        return;
+    QByteArray result = QFile::encodeName(fileName);
+    result.replace('$', "$$");
+    result.replace('#', "\\#");
+    result.replace(' ', "\\ ");
+
+    return result;
+}
+
+// Make/Ninja rule: the generated files depend on the spec and on the specs defining the types it uses.
+QByteArray dependencyRule(const CGeneratedCode &code, const QString &outputDirectory, const QString &specFile,
+                          const CTypeRegistry &typeRegistry)
+{
+    QStringList dependencies = QStringList() << specFile;
+
+    foreach (const QString &fileName, typeRegistry.dependencies(code.referencedTypes)) {
+        if (!dependencies.contains(fileName)) {
+            dependencies.append(fileName);
+        }
     }
 
-    QDomDocument document;
-    document.setContent(xmlFile.readAll());
-    xmlFile.close();
+    QByteArray rule;
 
-    const QDomElement interfaceElement = document.documentElement().firstChildElement(QLatin1String("interface"));
-    QString interfaceName = interfaceElement.attribute(QLatin1String("name"));
+    foreach (const QString &target, outputFileNames(code, outputDirectory)) {
+        if (!rule.isEmpty()) {
+            rule += ' ';
+        }
+        rule += escapeDependency(target);
+    }
 
-    CInterfaceGenerator generator;
-    generator.setFullName(interfaceName);
+    rule += ':';
 
-    if (!generator.isValid()) {
-        qCritical() << "File doesn't contain telepathy spec in known format (Error 1)";
-        return;
+    foreach (const QString &fileName, dependencies) {
+        rule += " \\\n  " + escapeDependency(fileName);
     }
 
-    generator.setNode(document.documentElement().attribute(QLatin1String("name")));
+    rule += '\n';
+
+    return rule;
+}
+
+void printCode(const CGeneratedCode &code, const QString &fileName)
+{
+    printf("Generated code for %s spec\n\n", fileName.toLocal8Bit().constData());
+
+    printf("--- Public header: ---\n");
+    fwrite(code.publicHeader.constData(), 1, code.publicHeader.size(), stdout);
+    printf("--- Private (internal) header: ---\n");
+    fwrite(code.internalHeader.constData(), 1, code.internalHeader.size(), stdout);
+    printf("--- Source file: ---\n");
+    fwrite(code.implementation.constData(), 1, code.implementation.size(), stdout);
+}
 
-    const QDomElement annotationElement = interfaceElement.firstChildElement(QLatin1String("annotation"));
-    if (!annotationElement.isNull()) {
-        const QString annotationName = annotationElement.attribute(QLatin1String("name"));
-        if (annotationName == QLatin1String("org.freedesktop.DBus.Property.EmitsChangedSignal")) {
-            generator.setEmitPropertiesChangedSignal(true);
+void readTypeDefinitions(const QStringList &fileNames, CTypeRegistry *typeRegistry)
+{
+    foreach (const QString &fileName, fileNames) {
+        QString errorString;
+        if (!typeRegistry->readFile(fileName, &errorString)) {
+            qWarning() << "Could not read type definitions:" << errorString;
         }
     }
+}
 
-    QDomElement propertyElement = interfaceElement.firstChildElement(QLatin1String("property"));
+QStringList collectSpecFiles(const QCommandLineParser &parser)
+{
+    QStringList specFiles;
 
-    while (!propertyElement.isNull()) {
-        if (!skipDeprecatedEntries || propertyElement.firstChildElement(s_deprecatedElement).isNull()) {
-            // Element is *not* deprecated.
-            CInterfaceProperty *property = new CInterfaceProperty();
-            property->setName(propertyElement.attribute(QLatin1String("name")));
-            property->setTypeFromStr(propertyElement.attribute(QLatin1String("type")), propertyElement.attribute(QLatin1String("tp:type")));
-            property->setImmutable(propertyElement.attribute(QLatin1String("tp:immutable")) == QLatin1String("yes"));
+    foreach (const QString &specDirName, parser.values(QLatin1String("spec-dir"))) {
+        const QDir specDir(specDirName);
+        if (!specDir.exists()) {
+            qCritical() << "Spec directory does not exist:" << specDirName;
+            continue;
+        }
 
-            QDomElement docString = propertyElement.firstChildElement(QLatin1String("tp:docstring"));
-            if (!docString.isNull()) {
-                QDomNodeList children = docString.childNodes();
-                for (int i = 0; i < children.count(); ++i) {
-                    if (children.at(i).toElement().text() == QLatin1String("This property cannot change during the lifetime of the channel.")) {
-                        property->setUnchangeable(true);
-                        break;
-                    }
-                }
-            }
-            generator.m_properties.append(property);
+        foreach (const QString &entry, specDir.entryList(QStringList() << QLatin1String("*.xml"), QDir::Files, QDir::Name)) {
+            specFiles.append(specDir.filePath(entry));
         }
+    }
+
+    specFiles += parser.positionalArguments();
+
+    return specFiles;
+}
+
+bool generationOptions(const QCommandLineParser &parser, uint *options)
+{
+    *options = CInterfaceGenerator::NoGenerationOptions;
 
-        propertyElement = propertyElement.nextSiblingElement(QLatin1String("property"));
+    if (parser.isSet(QLatin1String("cache-immutable-properties"))) {
+        *options |= CInterfaceGenerator::CacheImmutableProperties;
     }
 
-    QDomElement methodElement = interfaceElement.firstChildElement(QLatin1String("method"));
+    if (parser.isSet(QLatin1String("coalesce-property-changes"))) {
+        *options |= CInterfaceGenerator::CoalescePropertyChanges;
+    }
 
-    while (!methodElement.isNull()) {
-        if (!skipDeprecatedEntries || methodElement.firstChildElement(s_deprecatedElement).isNull()) {
-            // Element is *not* deprecated.
+    if (parser.isSet(QLatin1String("move-setters"))) {
+        *options |= CInterfaceGenerator::MoveAwareSetters;
+    }
 
-            CInterfaceMethod *method = new CInterfaceMethod(methodElement.attribute(QLatin1String("name")));
+    if (parser.isSet(QLatin1String("compare-before-assign"))) {
+        *options |= CInterfaceGenerator::CompareBeforeAssign;
+    }
 
-            QDomElement argElement = methodElement.firstChildElement(QLatin1String("arg"));
+    if (parser.isSet(QLatin1String("async-methods"))) {
+        *options |= CInterfaceGenerator::AsyncMethodDispatch;
+    }
 
-            while (!argElement.isNull()) {
-                CMethodArgument arg;
-                arg.setName(argElement.attribute(QLatin1String("name")));
-                arg.setTypeFromStr(argElement.attribute(QLatin1String("type")), argElement.attribute(QLatin1String("tp:type")));
-                arg.setDirection(argElement.attribute(QLatin1String("direction")));
+    if (parser.isSet(QLatin1String("inline-adaptee"))) {
+        *options |= CInterfaceGenerator::InlineAdaptee;
+    }
+
+    if (parser.isSet(QLatin1String("thread-safe-properties"))) {
+        *options |= CInterfaceGenerator::ThreadSafeProperties;
+    }
+
+    if (parser.isSet(QLatin1String("static-names"))) {
+        *options |= CInterfaceGenerator::StaticNameTable;
+    }
+
+    if (parser.isSet(QLatin1String("method-statistics"))) {
+        *options |= CInterfaceGenerator::MethodStatistics;
+    }
+
+    const QString trace = parser.value(QLatin1String("trace"));
+
+    if (trace == QLatin1String("macro")) {
+        *options |= CInterfaceGenerator::TraceMacro;
+    } else if (trace == QLatin1String("hook")) {
+        *options |= CInterfaceGenerator::TraceHook;
+    } else if (trace != QLatin1String("debug")) {
+        qCritical() << "Unknown trace mode:" << trace;
+        return false;
+    }
+
+    const QString target = parser.value(QLatin1String("target"));
+
+    if (target == QLatin1String("qt5")) {
+        *options |= CInterfaceGenerator::DirectSignalEmission;
+    } else if (target != QLatin1String("qt4")) {
+        qCritical() << "Unknown target:" << target;
+        return false;
+    }
 
-                method->arguments.append(arg);
+    return true;
+}
 
-                argElement = argElement.nextSiblingElement(QLatin1String("arg"));
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QLatin1String("Generates TelepathyQt service code from Telepathy specs."));
+    parser.addHelpOption();
+    parser.addPositionalArgument(QLatin1String("specs"), QLatin1String("Spec files to process."), QLatin1String("<specs file> [<specs file>...]"));
+    parser.addOption(QCommandLineOption(QLatin1String("spec-dir"),
+                                        QLatin1String("Process every *.xml file in <dir>. Can be given more than once."),
+                                        QLatin1String("dir")));
+    parser.addOption(QCommandLineOption(QStringList() << QLatin1String("j") << QLatin1String("jobs"),
+                                        QLatin1String("Number of specs processed in parallel (default: number of cores)."),
+                                        QLatin1String("n")));
+    parser.addOption(QCommandLineOption(QLatin1String("cache-dir"),
+                                        QLatin1String("Reuse the code generated for unchanged specs by a previous run from <dir>."),
+                                        QLatin1String("dir")));
+    parser.addOption(QCommandLineOption(QStringList() << QLatin1String("o") << QLatin1String("output-dir"),
+                                        QLatin1String("Write <class>.h, <class>-internal.h and <class>.cpp files to <dir> instead of printing the code. "
+                                                      "Files with unchanged content are not touched."),
+                                        QLatin1String("dir")));
+    parser.addOption(QCommandLineOption(QLatin1String("cache-immutable-properties"),
+                                        QLatin1String("Build the immutableProperties() map once per object and return the cached copy afterwards.")));
+    parser.addOption(QCommandLineOption(QLatin1String("coalesce-property-changes"),
+                                        QLatin1String("Announce property changes with one PropertiesChanged signal per event loop iteration.")));
+    parser.addOption(QCommandLineOption(QLatin1String("move-setters"),
+                                        QLatin1String("Add setter overloads that move rvalue arguments of non-POD properties (requires C++11).")));
+    parser.addOption(QCommandLineOption(QLatin1String("compare-before-assign"),
+                                        QLatin1String("Make setters ignore values equal to the stored ones, without announcing a change.")));
+    parser.addOption(QCommandLineOption(QLatin1String("async-methods"),
+                                        QLatin1String("Pass the method invocation context to the method callbacks, which finish the call themselves.")));
+    parser.addOption(QCommandLineOption(QLatin1String("inline-adaptee"),
+                                        QLatin1String("Allocate the adaptee together with the Private struct of the interface.")));
+    parser.addOption(QCommandLineOption(QLatin1String("thread-safe-properties"),
+                                        QLatin1String("Make the property getters safe to call from any thread without locking (requires C++11).")));
+    parser.addOption(QCommandLineOption(QLatin1String("static-names"),
+                                        QLatin1String("Use a static QStringLiteral table for the interface and property names (requires Qt5).")));
+    parser.addOption(QCommandLineOption(QLatin1String("method-statistics"),
+                                        QLatin1String("Count the calls, errors and latencies of the methods, readable with <Class>::methodStatistics().")));
+    parser.addOption(QCommandLineOption(QLatin1String("trace"),
+                                        QLatin1String("Tracing of the adaptee methods: debug, macro or hook (default: debug)."),
+                                        QLatin1String("mode"),
+                                        QLatin1String("debug")));
+    parser.addOption(QCommandLineOption(QLatin1String("target"),
+                                        QLatin1String("Qt version of the generated code, qt4 or qt5 (default: qt4). "
+                                                      "Qt5 code emits the adaptee signals directly."),
+                                        QLatin1String("version"),
+                                        QLatin1String("qt4")));
+    parser.addOption(QCommandLineOption(QLatin1String("tree"),
+                                        QLatin1String("Generate every interface of <spec> and of the specs it includes (xi:include), "
+                                                      "e.g. the upstream all.xml. The tree is read once."),
+                                        QLatin1String("spec")));
+    parser.addOption(QCommandLineOption(QLatin1String("type-spec"),
+                                        QLatin1String("Read the tp:type definitions of <file> (e.g. generic-types.xml) for the --depfile. "
+                                                      "Can be given more than once."),
+                                        QLatin1String("file")));
+    parser.addOption(QCommandLineOption(QLatin1String("depfile"),
+                                        QLatin1String("Write a Make/Ninja depfile of the generated files to <file> (requires --output-dir)."),
+                                        QLatin1String("file")));
+    parser.addOption(QCommandLineOption(QLatin1String("server"),
+                                        QLatin1String("Keep running and answer JSON-RPC requests on the local socket <name>. "
+                                                      "The given specs are regenerated whenever they change."),
+                                        QLatin1String("name")));
+    parser.process(app);
+
+    const bool serverMode = parser.isSet(QLatin1String("server"));
+
+    if (serverMode) {
+        // The clients choose the output directory per request, and the code is kept in memory.
+        static const char *const fileModeOptions[] = { "output-dir", "cache-dir", "depfile", "type-spec", "tree" };
+
+        for (uint i = 0; i < sizeof(fileModeOptions) / sizeof(fileModeOptions[0]); ++i) {
+            if (parser.isSet(QLatin1String(fileModeOptions[i]))) {
+                qCritical("The --%s option can not be used with --server", fileModeOptions[i]);
+                return 1;
             }
+        }
+    }
+    const QString treeFileName = parser.value(QLatin1String("tree"));
+    const QStringList specFiles = (serverMode || !treeFileName.isEmpty()) ? QStringList() : collectSpecFiles(parser);
+
+    if (specFiles.isEmpty() && !serverMode && treeFileName.isEmpty()) {
+        parser.showHelp(0);
+    }
+
+    if (parser.isSet(QLatin1String("jobs"))) {
+        bool ok = false;
+        const int jobs = parser.value(QLatin1String("jobs")).toInt(&ok);
+        if (!ok || (jobs < 1)) {
+            qCritical() << "Invalid jobs count:" << parser.value(QLatin1String("jobs"));
+            return 1;
+        }
+        QThreadPool::globalInstance()->setMaxThreadCount(jobs);
+    }
+
+    const QString outputDirectory = parser.value(QLatin1String("output-dir"));
+
+    const QString depfileName = parser.value(QLatin1String("depfile"));
+
+    // The cache is keyed by the spec file content, while the tree is read as a whole.
+    if (!treeFileName.isEmpty() && parser.isSet(QLatin1String("cache-dir"))) {
+        qCritical() << "The --cache-dir option can not be used with --tree";
+        return 1;
+    }
+
+    if (!depfileName.isEmpty() && outputDirectory.isEmpty()) {
+        qCritical() << "The depfile requires an output directory";
+        return 1;
+    }
+
+    if (!outputDirectory.isEmpty() && !QDir().mkpath(outputDirectory)) {
+        qCritical() << "Could not create output directory" << outputDirectory;
+        return 1;
+    }
+
+    uint options;
+
+    if (!generationOptions(parser, &options)) {
+        return 1;
+    }
+
+    if (serverMode) {
+        CGeneratorServer server(options);
 
-            generator.m_methods.append(method);
+        foreach (const QString &specDirName, parser.values(QLatin1String("spec-dir"))) {
+            server.addSpecDirectory(specDirName);
         }
+        server.addSpecFiles(parser.positionalArguments());
 
-        methodElement = methodElement.nextSiblingElement(QLatin1String("method"));
+        if (!server.listen(parser.value(QLatin1String("server")))) {
+            return 1;
+        }
+
+        return app.exec();
     }
 
+    QScopedPointer<CGenerationCache> cache;
 
-    QDomElement signalElement = interfaceElement.firstChildElement(QLatin1String("signal"));
+    if (parser.isSet(QLatin1String("cache-dir"))) {
+        const QByteArray generatorStamp = CGenerationCache::generatorStamp(QCoreApplication::applicationFilePath());
 
-    while (!signalElement.isNull()) {
-        if (!skipDeprecatedEntries || signalElement.firstChildElement(s_deprecatedElement).isNull()) {
-            // Element is *not* deprecated.
+        if (!generatorStamp.isEmpty()) {
+            // The same spec generates different code with different options.
+            cache.reset(new CGenerationCache(parser.value(QLatin1String("cache-dir")),
+                                             generatorStamp + " options=" + QByteArray::number(options)));
+        }
 
-            CInterfaceSignal *signal = new CInterfaceSignal(signalElement.attribute(QLatin1String("name")));
+        if (!cache || !cache->isValid()) {
+            qWarning() << "The generation cache is disabled";
+            cache.reset();
+        }
+    }
+
+    int failedCount = 0;
+    CTypeRegistry typeRegistry;
+    QList<CInterfaceGenerator*> treeInterfaces;
+    QStringList resultSpecFiles; // The spec file of each result
+    QFuture<CGeneratedCode> future;
+
+    // The shared type definitions; those of the processed specs are collected while they are parsed.
+    if (!depfileName.isEmpty()) {
+        readTypeDefinitions(parser.values(QLatin1String("type-spec")), &typeRegistry);
+    }
 
-            QDomElement argElement = signalElement.firstChildElement(QLatin1String("arg"));
+    // Specs (or interfaces of the tree) are processed on the global thread pool, but the results are
+    // printed in the input order, so the output does not depend on the scheduling.
+    if (!treeFileName.isEmpty()) {
+        QString errorString;
+        QStringList skippedInterfaces;
+        treeInterfaces = CServiceGenerator(options).readTree(treeFileName, &typeRegistry, 0, &errorString, &skippedInterfaces);
 
-            while (!argElement.isNull()) {
-                CMethodArgument arg;
-                arg.setName(argElement.attribute(QLatin1String("name")));
-                arg.setTypeFromStr(argElement.attribute(QLatin1String("type")), argElement.attribute(QLatin1String("tp:type")));
-                arg.setDirection(QLatin1String("in"));
+        // Counted as failed, like the specs that can not be read in the per-file mode.
+        foreach (const QString &skippedInterface, skippedInterfaces) {
+            qCritical() << "Could not read interface" << skippedInterface;
+        }
+        failedCount += skippedInterfaces.count();
 
-                signal->arguments.append(arg);
+        if (treeInterfaces.isEmpty()) {
+            if (errorString.isEmpty()) {
+                errorString = QLatin1String("There is no interface to generate");
+            }
+            qCritical() << "Could not read spec tree" << treeFileName << ":" << errorString;
+            return 1;
+        }
 
-                argElement = argElement.nextSiblingElement(QLatin1String("arg"));
+        // Interfaces with the same class name would overwrite each other's files.
+        QHash<QString, const CInterfaceGenerator*> interfacesByClassName;
+        bool duplicateClassNames = false;
+
+        foreach (const CInterfaceGenerator *generator, treeInterfaces) {
+            const CInterfaceGenerator *other = interfacesByClassName.value(generator->className());
+            if (other) {
+                qCritical() << "Interfaces" << other->dbusName() << "in" << other->specFileName() << "and"
+                            << generator->dbusName() << "in" << generator->specFileName()
+                            << "have the same class name" << generator->className();
+                duplicateClassNames = true;
+                continue;
             }
+            interfacesByClassName.insert(generator->className(), generator);
+            resultSpecFiles.append(generator->specFileName());
+        }
 
-            generator.m_signals.append(signal);
+        if (duplicateClassNames) {
+            qDeleteAll(treeInterfaces);
+            return 1;
         }
 
-        signalElement = signalElement.nextSiblingElement(QLatin1String("signal"));
+        future = QtConcurrent::mapped(treeInterfaces, InterfaceProcessor(options));
+    } else {
+        resultSpecFiles = specFiles;
+        future = QtConcurrent::mapped(specFiles, SpecProcessor(cache.data(), options));
     }
 
-    generator.prepare();
+    for (int i = 0; i < resultSpecFiles.count(); ++i) {
+        const CGeneratedCode code = future.resultAt(i);
 
-    printf("Generated code for %s spec\n\n", fileName.toLocal8Bit().constData());
+        typeRegistry.merge(code.typeDefinitions, resultSpecFiles.at(i));
 
-    printf("--- Public header: ---\n");
-    printf("%s", generator.generateHeaderInterface().toLocal8Bit().constData());
-    printf("--- Private (internal) header: ---\n");
-    printf("%s", generator.generateHeaderAdaptee().toLocal8Bit().constData());
-    printf("--- Source file: ---\n");
-    printf("%s", generator.generateImplementations().toLocal8Bit().constData());
-}
+        if (!code.isValid()) {
+            ++failedCount;
+            continue;
+        }
 
-int main(int argc, char *argv[])
-{
-    if (argc < 2) {
-        printf("Usage: %s <specs file>\n", argv[0]);
-        return 0;
+        if (outputDirectory.isEmpty()) {
+            printCode(code, resultSpecFiles.at(i));
+        } else if (!writeCode(code, outputDirectory)) {
+            ++failedCount;
+        }
+    }
+
+    // The rules need the type definitions of all specs.
+    if (!depfileName.isEmpty()) {
+        QByteArray depfileContent;
+
+        for (int i = 0; i < resultSpecFiles.count(); ++i) {
+            const CGeneratedCode code = future.resultAt(i);
+
+            if (code.isValid()) {
+                depfileContent += dependencyRule(code, outputDirectory, resultSpecFiles.at(i), typeRegistry);
+            }
+        }
+
+        if (!writeFileIfChanged(depfileName, depfileContent)) {
+            ++failedCount;
+        }
     }
 
-    processSpec(QString::fromLocal8Bit(argv[1]));
+    future.waitForFinished();
+    qDeleteAll(treeInterfaces);
 
-    return 0;
+    return failedCount ? 1 : 0;
 }
@@ -4,14 +4,8 @@
 #
 #-------------------------------------------------
 
-QT = core xml
+TEMPLATE = subdirs
 
-TARGET = telepathy-qt-generator
+SUBDIRS = lib app
 
-TEMPLATE = app
-
-SOURCES += main.cpp \
-    CInterfaceGenerator.cpp
-
-HEADERS += \
-    CInterfaceGenerator.hpp
+app.depends = lib
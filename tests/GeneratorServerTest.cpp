@@ -0,0 +1,221 @@
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLocalSocket>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include "CGeneratorServer.hpp"
+
+// Talks to CGeneratorServer the way an IDE plugin would: JSON-RPC lines over a local socket.
+
+class GeneratorServerTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void init();
+    void cleanup();
+
+    void generate();
+    void generateUnknownFile();
+    void list();
+    void specChanged();
+    void unknownMethod();
+
+private:
+    static QByteArray spec(const QByteArray &interfaceName);
+    void writeSpec(const QByteArray &interfaceName);
+    void sendRequest(int id, const QString &method, const QJsonObject &params = QJsonObject());
+    void readMessage(QJsonObject *message);
+    void readResponse(int id, QJsonObject *response);
+
+    QTemporaryDir *m_specDir;
+    QString m_specFileName;
+    CGeneratorServer *m_server;
+    QLocalSocket *m_socket;
+
+};
+
+void GeneratorServerTest::init()
+{
+    m_specDir = new QTemporaryDir();
+    QVERIFY(m_specDir->isValid());
+
+    m_specFileName = m_specDir->path() + QLatin1String("/Connection_Interface_Synthetic.xml");
+    writeSpec("Synthetic");
+
+    m_server = new CGeneratorServer(0);
+    m_server->addSpecFiles(QStringList() << m_specFileName);
+
+    const QString serverName = QString(QLatin1String("telepathy-qt-generator-test-%1")).arg(QCoreApplication::applicationPid());
+    QVERIFY(m_server->listen(serverName));
+
+    m_socket = new QLocalSocket();
+    m_socket->connectToServer(serverName);
+    QTRY_COMPARE(m_socket->state(), QLocalSocket::ConnectedState);
+}
+
+void GeneratorServerTest::cleanup()
+{
+    delete m_socket;
+    delete m_server;
+    delete m_specDir;
+}
+
+void GeneratorServerTest::generate()
+{
+    QJsonObject params;
+    params[QLatin1String("file")] = m_specFileName;
+    sendRequest(1, QLatin1String("generate"), params);
+
+    QJsonObject response;
+    readResponse(1, &response);
+
+    QVERIFY(!response.contains(QLatin1String("error")));
+    const QJsonObject result = response.value(QLatin1String("result")).toObject();
+    QVERIFY(result.value(QLatin1String("className")).toString().contains(QLatin1String("Synthetic")));
+    QVERIFY(result.value(QLatin1String("publicHeader")).toString().contains(QLatin1String("class ")));
+    QVERIFY(!result.value(QLatin1String("internalHeader")).toString().isEmpty());
+    QVERIFY(!result.value(QLatin1String("implementation")).toString().isEmpty());
+}
+
+void GeneratorServerTest::generateUnknownFile()
+{
+    QJsonObject params;
+    params[QLatin1String("file")] = m_specDir->path() + QLatin1String("/Missing.xml");
+    sendRequest(2, QLatin1String("generate"), params);
+
+    QJsonObject response;
+    readResponse(2, &response);
+
+    QVERIFY(response.contains(QLatin1String("error")));
+    QVERIFY(!response.contains(QLatin1String("result")));
+}
+
+void GeneratorServerTest::list()
+{
+    sendRequest(3, QLatin1String("list"));
+
+    QJsonObject response;
+    readResponse(3, &response);
+
+    const QJsonArray specs = response.value(QLatin1String("result")).toObject().value(QLatin1String("specs")).toArray();
+    QCOMPARE(specs.count(), 1);
+
+    const QJsonObject spec = specs.first().toObject();
+    QCOMPARE(spec.value(QLatin1String("file")).toString(), m_specFileName);
+    QVERIFY(spec.value(QLatin1String("className")).toString().contains(QLatin1String("Synthetic")));
+}
+
+void GeneratorServerTest::specChanged()
+{
+    writeSpec("Renamed");
+
+    // The watcher may report the rewrite in several steps (e.g. truncation first), so wait for the final state.
+    bool renamed = false;
+
+    for (int i = 0; (i < 10) && !renamed; ++i) {
+        QJsonObject message;
+        readMessage(&message);
+        if (QTest::currentTestFailed()) {
+            return;
+        }
+
+        QCOMPARE(message.value(QLatin1String("method")).toString(), QString(QLatin1String("specChanged")));
+
+        const QJsonObject params = message.value(QLatin1String("params")).toObject();
+        QCOMPARE(params.value(QLatin1String("file")).toString(), m_specFileName);
+        renamed = params.value(QLatin1String("className")).toString().contains(QLatin1String("Renamed"));
+    }
+
+    QVERIFY(renamed);
+
+    // Answered from memory with the new code
+    QJsonObject params;
+    params[QLatin1String("file")] = m_specFileName;
+    sendRequest(4, QLatin1String("generate"), params);
+
+    QJsonObject response;
+    readResponse(4, &response);
+
+    const QJsonObject result = response.value(QLatin1String("result")).toObject();
+    QVERIFY(result.value(QLatin1String("className")).toString().contains(QLatin1String("Renamed")));
+}
+
+void GeneratorServerTest::unknownMethod()
+{
+    sendRequest(5, QLatin1String("frobnicate"));
+
+    QJsonObject response;
+    readResponse(5, &response);
+
+    QCOMPARE(response.value(QLatin1String("error")).toObject().value(QLatin1String("code")).toInt(), -32601);
+}
+
+QByteArray GeneratorServerTest::spec(const QByteArray &interfaceName)
+{
+    return "<?xml version=\"1.0\" ?>\n"
+           "<node name=\"/Connection_Interface_" + interfaceName + "\" xmlns:tp=\"http://telepathy.freedesktop.org/wiki/DbusSpec#extensions-v0\">\n"
+           "<interface name=\"org.freedesktop.Telepathy.Connection.Interface." + interfaceName + "\">\n"
+           "<property name=\"Value\" type=\"u\" access=\"read\"/>\n"
+           "<method name=\"Request\">\n"
+           "<arg name=\"Input\" direction=\"in\" type=\"s\"/>\n"
+           "<arg name=\"Output\" direction=\"out\" type=\"u\"/>\n"
+           "</method>\n"
+           "<signal name=\"ValueChanged\">\n"
+           "<arg name=\"Value\" type=\"u\"/>\n"
+           "</signal>\n"
+           "</interface>\n"
+           "</node>\n";
+}
+
+void GeneratorServerTest::writeSpec(const QByteArray &interfaceName)
+{
+    QFile specFile(m_specFileName);
+    QVERIFY(specFile.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    QVERIFY(specFile.write(spec(interfaceName)) > 0);
+}
+
+void GeneratorServerTest::sendRequest(int id, const QString &method, const QJsonObject &params)
+{
+    QJsonObject request;
+    request[QLatin1String("jsonrpc")] = QLatin1String("2.0");
+    request[QLatin1String("id")] = id;
+    request[QLatin1String("method")] = method;
+    request[QLatin1String("params")] = params;
+
+    m_socket->write(QJsonDocument(request).toJson(QJsonDocument::Compact) + '\n');
+    m_socket->flush();
+}
+
+void GeneratorServerTest::readMessage(QJsonObject *message)
+{
+    // The server runs in this thread, so wait with the event loop running.
+    QTRY_VERIFY_WITH_TIMEOUT(m_socket->canReadLine(), 10000);
+
+    const QJsonDocument document = QJsonDocument::fromJson(m_socket->readLine());
+    QVERIFY(document.isObject());
+
+    *message = document.object();
+    QCOMPARE(message->value(QLatin1String("jsonrpc")).toString(), QString(QLatin1String("2.0")));
+}
+
+void GeneratorServerTest::readResponse(int id, QJsonObject *response)
+{
+    // Skip the notifications
+    do {
+        readMessage(response);
+        if (QTest::currentTestFailed()) {
+            return;
+        }
+    } while (!response->contains(QLatin1String("id")));
+
+    QCOMPARE(response->value(QLatin1String("id")).toInt(), id);
+}
+
+QTEST_GUILESS_MAIN(GeneratorServerTest)
+
+#include "GeneratorServerTest.moc"
@@ -0,0 +1,23 @@
+#-------------------------------------------------
+#
+# Generator tests (QTest based)
+#
+#-------------------------------------------------
+
+QT = core network testlib
+
+TARGET = generator-server-test
+
+TEMPLATE = app
+
+CONFIG += console testcase
+
+include(../generator.pri)
+
+SOURCES += GeneratorServerTest.cpp \
+    ../CGeneratorServer.cpp \
+    ../FileUtils.cpp
+
+HEADERS += \
+    ../CGeneratorServer.hpp \
+    ../FileUtils.hpp